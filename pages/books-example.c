@@ -12,8 +12,10 @@ typedef struct descent_xml_lex lex_t;
 #define unexpected descent_xml_classifier_unexpected
 #define close descent_xml_classifier_element_close_name
 #define error descent_xml_parse_error
-#define parse descent_xml_parse_cstr
-#define valid descent_xml_validate_document
+#define invalid descent_xml_validate_error
+#define parse descent_xml_validate_parse_cstr
+
+typedef struct descent_xml_validate_state state_t;
 
 #define XML \
 "<?xml version=\"1.0\" ?>\n" \
@@ -46,7 +48,8 @@ static int is_end_type(lex_t token)
 static int is_error_type(lex_t token)
 {
 	return token.type == unexpected
-		|| token.type == error;
+		|| token.type == error
+		|| token.type == invalid;
 }
 
 static int equal(const char *a, const char *b)
@@ -73,7 +76,9 @@ lex_t author_handler(
 	void *context
 )
 {
-	(void)context;
+	// The validator's state is passed through the
+	// context, so that it sees the tokens we read here
+	state_t *const state = context;
 	(void)attributes;
 	if (!empty && equal(element_name, "author")) {
 		printf("Author: ");
@@ -86,7 +91,7 @@ lex_t author_handler(
 		while (token.type != close) {
 			if (is_end_type(token) || is_error_type(token))
 				return token;
-			token = parse(token, NULL, text_printer, NULL);
+			token = parse(state, token, NULL, text_printer, NULL);
 		}
 		printf("\n");
 	} else if (!empty) {
@@ -97,12 +102,12 @@ lex_t author_handler(
 		while (token.type != close) {
 			if (is_end_type(token) || is_error_type(token))
 				return token;
-			token = parse(token, NULL, NULL, NULL);
+			token = parse(state, token, NULL, NULL, NULL);
 		}
 	}
 	// We iterate past the closing slash to allow the
 	// caller to check for its own closing element.
-	token = parse(token, NULL, NULL, NULL);
+	token = parse(state, token, NULL, NULL, NULL);
 	return token;
 }
 
@@ -114,7 +119,7 @@ lex_t book_handler(
 	void *context
 )
 {
-	(void)context;
+	state_t *const state = context;
 	if (empty || !equal(element_name, "book"))
 		return token;
 
@@ -138,9 +143,9 @@ lex_t book_handler(
 			while (token.type != close) {
 				if (is_end_type(token) || is_error_type(token))
 					return token;
-				token = parse(token, author_handler, NULL, NULL);
+				token = parse(state, token, author_handler, NULL, state);
 			}
-			token = parse(token, NULL, NULL, NULL);
+			token = parse(state, token, NULL, NULL, NULL);
 		}
 	}
 	return token;
@@ -149,15 +154,16 @@ lex_t book_handler(
 int main()
 {
 	lex_t token = lex(str(XML));
-	if (!valid(token))
-		return 1;
+	state_t state = descent_xml_validate_state_init(1000);
 
 	while (!is_end_type(token)) {
 		if (is_error_type(token)) {
 			// Handle error
+			descent_xml_validate_state_free(&state);
 			return 1;
 		}
 
-		token = parse(token, book_handler, NULL, NULL);
+		token = parse(&state, token, book_handler, NULL, &state);
 	}
+	descent_xml_validate_state_free(&state);
 }
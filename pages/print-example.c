@@ -11,8 +11,8 @@ typedef struct descent_xml_lex lex_t;
 #define eof descent_xml_classifier_eof
 #define unexpected descent_xml_classifier_unexpected
 #define error descent_xml_parse_error
-#define parse descent_xml_parse_cstr
-#define valid descent_xml_validate_document
+#define invalid descent_xml_validate_error
+#define parse descent_xml_validate_parse_cstr
 
 static int is_end_type(lex_t token)
 {
@@ -22,7 +22,8 @@ static int is_end_type(lex_t token)
 static int is_error_type(lex_t token)
 {
 	return token.type == unexpected
-		|| token.type == error;
+		|| token.type == error
+		|| token.type == invalid;
 }
 
 lex_t element_handler(
@@ -63,15 +64,17 @@ int main()
 		"	Hello, after CDATA!\n"
 		"</element>"
 	));
-	if (!valid(token))
-		return 1;
+	struct descent_xml_validate_state state
+		= descent_xml_validate_state_init(1000);
 
 	while (!is_end_type(token)) {
 		if (is_error_type(token)) {
 			// Handle error
+			descent_xml_validate_state_free(&state);
 			return 1;
 		}
 
-		token = parse(token, element_handler, text_handler, NULL);
+		token = parse(&state, token, element_handler, text_handler, NULL);
 	}
+	descent_xml_validate_state_free(&state);
 }
@@ -0,0 +1,4 @@
+# Lets downstream projects use descent_xml_dispatch() with
+# find_package(DescentXML), to generate dispatchers for their own
+# element names. The library itself is found as usual.
+include(${CMAKE_CURRENT_LIST_DIR}/DescentXMLDispatch.cmake)
@@ -0,0 +1,29 @@
+# descent_xml_dispatch(target prefix names)
+#
+# Generates ${prefix}.h from a file of element names, one per line,
+# and makes it includable from target. See descent-xml/dispatch.h.
+#
+# In this tree, descent-xml-dispatch-gen is built alongside the
+# library. Installed, this module looks for the installed program
+# instead, next to the library or on the PATH.
+
+if (NOT TARGET descent-xml-dispatch-gen)
+	find_program(DESCENT_XML_DISPATCH_GEN descent-xml-dispatch-gen
+		HINTS ${CMAKE_CURRENT_LIST_DIR}/../../../bin
+		REQUIRED)
+	add_executable(descent-xml-dispatch-gen IMPORTED)
+	set_target_properties(descent-xml-dispatch-gen PROPERTIES
+		IMPORTED_LOCATION ${DESCENT_XML_DISPATCH_GEN})
+endif()
+
+function(descent_xml_dispatch target prefix names)
+	set(header ${CMAKE_CURRENT_BINARY_DIR}/${prefix}.h)
+	cmake_path(ABSOLUTE_PATH names BASE_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR})
+	add_custom_command(
+		OUTPUT ${header}
+		COMMAND descent-xml-dispatch-gen ${prefix} ${names} ${header}
+		DEPENDS descent-xml-dispatch-gen ${names}
+		COMMENT "Generating element dispatcher ${prefix}.h")
+	target_sources(${target} PRIVATE ${header})
+	target_include_directories(${target} PRIVATE ${CMAKE_CURRENT_BINARY_DIR})
+endfunction()
@@ -0,0 +1,23 @@
+#include "descent-xml/arena.h"
+
+struct descent_xml_arena descent_xml_arena_init(void);
+void descent_xml_arena_free(struct descent_xml_arena *arena);
+struct descent_xml_arena_mark descent_xml_arena_mark(
+	const struct descent_xml_arena *arena
+);
+void descent_xml_arena_reset(
+	struct descent_xml_arena *arena,
+	struct descent_xml_arena_mark mark
+);
+bool _descent_xml_arena_advance(
+	struct descent_xml_arena *arena,
+	size_t size
+);
+void *descent_xml_arena_alloc(
+	struct descent_xml_arena *arena,
+	size_t size
+);
+char *descent_xml_arena_strndup(
+	struct descent_xml_arena *arena,
+	struct libadt_const_lptr string
+);
@@ -0,0 +1,108 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "descent-xml/classifier.h"
+
+#define S(name) DESCENT_XML_CLASSIFIER_ ## name
+
+// One past the largest code point
+#define CODE_POINTS 0x110000
+
+typedef descent_xml_classifier_fn cfn;
+typedef unsigned char row_t[_DESCENT_XML_CLASSIFIER_CLASS_COUNT];
+
+static void usage(const char *const program)
+{
+	fprintf(stderr, "Usage: %s OUTPUT\n", program);
+	fprintf(stderr, "\nGenerates the transition table for descent_xml_classifier_next()\n");
+	fprintf(stderr, "by running every character through the classifier functions.\n");
+}
+
+static unsigned char cclass(wchar_t input)
+{
+	return (wint_t)input < 256
+		? _descent_xml_classifier_byte_classes[input]
+		: _descent_xml_classifier_wide_class(input);
+}
+
+// Records the state's transition for one character. Returns
+// false if another character of the same class went elsewhere,
+// in which case the classes are too coarse for a table.
+static bool record(
+	row_t row,
+	bool *seen,
+	enum descent_xml_classifier_state state,
+	wchar_t input
+)
+{
+	const enum descent_xml_classifier_state next =
+		descent_xml_classifier_fn_state(
+			(cfn *)descent_xml_classifier_state_fn(state)(input)
+		);
+	const unsigned char c = cclass(input);
+
+	if (next == S(STATE_COUNT)) {
+		fprintf(stderr, "State %d returned an unknown function for U+%04X\n",
+			(int)state, (unsigned)input);
+		return false;
+	}
+	if (seen[c] && row[c] != next) {
+		fprintf(stderr, "State %d maps class %u to both %u and %d (at U+%04X)\n",
+			(int)state, (unsigned)c, (unsigned)row[c], (int)next,
+			(unsigned)input);
+		return false;
+	}
+	row[c] = (unsigned char)next;
+	seen[c] = true;
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	// The rows for S(UNEXPECTED) and S(EOF) stay zero, which is
+	// S(UNEXPECTED): their functions abort instead of returning
+	static row_t table[S(STATE_COUNT)];
+	for (int state = S(START); state < S(STATE_COUNT); state++) {
+		bool seen[_DESCENT_XML_CLASSIFIER_CLASS_COUNT] = { false };
+		for (wchar_t input = 0; input < CODE_POINTS; input++)
+			if (!record(table[state], seen, state, input))
+				return 1;
+		if (!record(table[state], seen, state, WEOF))
+			return 1;
+	}
+
+	FILE *output = fopen(argv[1], "w");
+	if (!output) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	fprintf(output, "// Generated by descent-xml-classifier-gen. Do not edit.\n\n");
+	fprintf(output, "#include \"descent-xml/classifier.h\"\n\n");
+	fprintf(output, "enum descent_xml_classifier_state descent_xml_classifier_next(\n");
+	fprintf(output, "\tenum descent_xml_classifier_state state,\n");
+	fprintf(output, "\twchar_t input\n");
+	fprintf(output, ");\n\n");
+	fprintf(output, "const unsigned char _descent_xml_classifier_transitions\n");
+	fprintf(output, "\t[DESCENT_XML_CLASSIFIER_STATE_COUNT]\n");
+	fprintf(output, "\t[_DESCENT_XML_CLASSIFIER_CLASS_COUNT] = {\n");
+	for (int state = 0; state < S(STATE_COUNT); state++) {
+		fprintf(output, "\t[%d] = {", state);
+		for (int c = 0; c < _DESCENT_XML_CLASSIFIER_CLASS_COUNT; c++)
+			fprintf(output, " %u,", (unsigned)table[state][c]);
+		fprintf(output, " },\n");
+	}
+	fprintf(output, "};\n");
+
+	if (fclose(output)) {
+		perror(argv[1]);
+		return 1;
+	}
+	return 0;
+}
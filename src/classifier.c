@@ -1,8 +1,9 @@
 #include "descent-xml/classifier.h"
 
-#include <wctype.h>
-#include <stdbool.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <wctype.h>
 
 // https://www.w3.org/TR/REC-xml/#sec-documents
 
@@ -41,87 +42,151 @@ cfn *const descent_xml_classifier_eof = eof_impl;
 
 // character classes
 typedef enum {
-	CCLASS_UNKNOWN = -1,
-	CCLASS_EOF = 0,
+	CCLASS_EOF,
 	CCLASS_NAME_START,
 	CCLASS_NAME,
 	CCLASS_SPACE,
 	CCLASS_TEXT,
-	CCLASS_EQUALS = '=',
-	CCLASS_HASH = '#',
-	CCLASS_OBRACKET = '<',
-	CCLASS_CBRACKET = '>',
-	CCLASS_DQUOTE = '"',
-	CCLASS_SQUOTE = '\'',
-	CCLASS_REF_START = '%',
-	CCLASS_ENTITY_START = '&',
-	CCLASS_ENTITY_END = ';',
-	CCLASS_EMARK = '!',
-	CCLASS_DASH = '-',
-	CCLASS_QMARK = '?',
-	CCLASS_SLASH = '/',
+	CCLASS_EQUALS,
+	CCLASS_HASH,
+	CCLASS_OBRACKET,
+	CCLASS_CBRACKET,
+	CCLASS_DQUOTE,
+	CCLASS_SQUOTE,
+	CCLASS_REF_START,
+	CCLASS_ENTITY_START,
+	CCLASS_ENTITY_END,
+	CCLASS_EMARK,
+	CCLASS_DASH,
+	CCLASS_QMARK,
+	CCLASS_SLASH,
+	// Only returned for the transition table: the
+	// classifier functions see it as a name character
+	CCLASS_BOM,
+	CCLASS_COUNT,
 } CHARACTER_CLASS;
 
-static bool in(const wchar_t c, const wchar_t *set)
-{
-	for (; *set; set++)
-		if (c == *set)
-			return true;
-	return false;
-}
-
-static bool between(const wchar_t start, const wchar_t c, const wchar_t end)
-{
-	return start <= c
-		&& c <= end;
+_Static_assert(
+	(int)CCLASS_COUNT == (int)_DESCENT_XML_CLASSIFIER_CLASS_COUNT,
+	"classifier.h needs the number of character classes"
+);
+
+// Everything below 0x100 gets looked up directly.
+// Punctuation is in here too, so the hot states
+// only ever do a single load per character.
+#define EF CCLASS_EOF
+#define NS CCLASS_NAME_START
+#define NM CCLASS_NAME
+#define SP CCLASS_SPACE
+#define TX CCLASS_TEXT
+#define EQ CCLASS_EQUALS
+#define HS CCLASS_HASH
+#define OB CCLASS_OBRACKET
+#define CB CCLASS_CBRACKET
+#define DQ CCLASS_DQUOTE
+#define SQ CCLASS_SQUOTE
+#define PC CCLASS_REF_START
+#define AM CCLASS_ENTITY_START
+#define SC CCLASS_ENTITY_END
+#define EM CCLASS_EMARK
+#define DS CCLASS_DASH
+#define QM CCLASS_QMARK
+#define SL CCLASS_SLASH
+
+const unsigned char _descent_xml_classifier_byte_classes[256] = {
+	/* 00 */ EF, TX, TX, TX, TX, TX, TX, TX, TX, SP, SP, TX, TX, SP, TX, TX,
+	/* 10 */ TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX,
+	/* 20 */ SP, EM, DQ, HS, TX, PC, AM, SQ, TX, TX, TX, TX, TX, DS, NM, SL,
+	/* 30 */ NM, NM, NM, NM, NM, NM, NM, NM, NM, NM, NS, SC, OB, EQ, CB, QM,
+	/* 40 */ TX, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS,
+	/* 50 */ NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, TX, TX, TX, TX, NS,
+	/* 60 */ TX, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS,
+	/* 70 */ NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, TX, TX, TX, TX, TX,
+	/* 80 */ TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX,
+	/* 90 */ TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX,
+	/* A0 */ TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX, TX,
+	/* B0 */ TX, TX, TX, TX, TX, TX, TX, NM, TX, TX, TX, TX, TX, TX, TX, TX,
+	/* C0 */ NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS,
+	/* D0 */ NS, NS, NS, NS, NS, NS, NS, TX, NS, NS, NS, NS, NS, NS, NS, NS,
+	/* E0 */ NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS,
+	/* F0 */ NS, NS, NS, NS, NS, NS, NS, TX, NS, NS, NS, NS, NS, NS, NS, NS,
+};
+
+#undef EF
+#undef NS
+#undef NM
+#undef SP
+#undef TX
+#undef EQ
+#undef HS
+#undef OB
+#undef CB
+#undef DQ
+#undef SQ
+#undef PC
+#undef AM
+#undef SC
+#undef EM
+#undef DS
+#undef QM
+#undef SL
+
+// NameStartChar and NameChar ranges from the spec,
+// above the range covered by the byte table. Sorted,
+// so they can be binary searched.
+//
+// https://www.w3.org/TR/REC-xml/#NT-NameStartChar
+static const struct {
+	wchar_t start;
+	wchar_t end;
+	CHARACTER_CLASS cclass;
+} name_ranges[] = {
+	{ 0x100, 0x2FF, CCLASS_NAME_START },
+	{ 0x300, 0x36F, CCLASS_NAME },
+	{ 0x370, 0x37D, CCLASS_NAME_START },
+	{ 0x37F, 0x1FFF, CCLASS_NAME_START },
+	{ 0x200C, 0x200D, CCLASS_NAME_START },
+	{ 0x203F, 0x2040, CCLASS_NAME },
+	{ 0x2070, 0x218F, CCLASS_NAME_START },
+	{ 0x2C00, 0x2FEF, CCLASS_NAME_START },
+	{ 0x3001, 0xD7FF, CCLASS_NAME_START },
+	{ 0xF900, 0xFDCF, CCLASS_NAME_START },
+	{ 0xFDF0, 0xFFFD, CCLASS_NAME_START },
+	{ 0x10000, 0xEFFFF, CCLASS_NAME_START },
+};
+
+static CHARACTER_CLASS get_wide_cclass(wchar_t c)
+{
+	size_t low = 0;
+	size_t high = sizeof(name_ranges) / sizeof(name_ranges[0]);
+	while (low < high) {
+		const size_t middle = low + (high - low) / 2;
+		if (c < name_ranges[middle].start)
+			high = middle;
+		else if (c > name_ranges[middle].end)
+			low = middle + 1;
+		else
+			return name_ranges[middle].cclass;
+	}
+	return CCLASS_TEXT;
 }
 
 static CHARACTER_CLASS get_cclass(wchar_t c)
 {
-	if (in(c, L"<>'\"&#=;!-%/?"))
-		return c;
-
-	const bool is_name_start
-		= in(c, L":_")
-		|| iswalpha((wint_t)c)
-		// I don't know what these numbers mean,
-		// but they're in the spec
-		// [#xC0-#xD6] | [#xD8-#xF6] | [#xF8-#x2FF] | [#x370-#x37D] | [#x37F-#x1FFF] | [#x200C-#x200D] | [#x2070-#x218F] | [#x2C00-#x2FEF] | [#x3001-#xD7FF] | [#xF900-#xFDCF] | [#xFDF0-#xFFFD] | [#x10000-#xEFFFF]
-		|| between(0xC0, c, 0xD6)
-		|| between(0xD8, c, 0xF6)
-		|| between(0xF8, c, 0x2FF)
-		|| between(0x370, c, 0x37D)
-		|| between(0x37F, c, 0x1FFF)
-		|| between(0x200C, c, 0x200D)
-		|| between(0x2070, c, 0x218F)
-		|| between(0x2C00, c, 0x2FEF)
-		|| between(0x3001, c, 0xD7FF)
-		|| between(0xF900, c, 0xFDCF)
-		|| between(0xFDF0, c, 0xFFFD)
-		|| between(0x10000, c, 0xEFFFF);
-
-	if (is_name_start)
-		return CCLASS_NAME_START;
-
-	const bool is_name
-		= c == '.'
-		|| iswdigit((wint_t)c)
-		// more magic numbers
-		// #xB7 | [#x0300-#x036F] | [#x203F-#x2040]
-		|| c == 0xB7
-		|| between(0x300, c, 0x36F)
-		|| between(0x203F, c, 0x2040);
-
-	if (is_name)
-		return CCLASS_NAME;
-
-	if (in(c, L" \t\r\n"))
-		return CCLASS_SPACE;
-
-	if (c == (wchar_t)WEOF || c == 0)
+	if ((wint_t)c < sizeof(_descent_xml_classifier_byte_classes))
+		return _descent_xml_classifier_byte_classes[c];
+
+	if (c == (wchar_t)WEOF)
 		return CCLASS_EOF;
 
-	return CCLASS_TEXT;
+	return get_wide_cclass(c);
+}
+
+unsigned char _descent_xml_classifier_wide_class(wchar_t input)
+{
+	if (input == 0xFEFF)
+		return CCLASS_BOM;
+	return (unsigned char)get_cclass(input);
 }
 
 static cfn *entity_start(wchar_t input, cfn *cont)
@@ -496,3 +561,92 @@ vfn *descent_xml_classifier_text_space(wchar_t input)
 	}
 }
 
+
+// The table-driven engine
+
+#define S(name) DESCENT_XML_CLASSIFIER_ ## name
+
+static cfn *const state_fns[DESCENT_XML_CLASSIFIER_STATE_COUNT] = {
+	[S(UNEXPECTED)] = unexpected_impl,
+	[S(EOF)] = eof_impl,
+	[S(START)] = descent_xml_classifier_start,
+	[S(TEXT)] = descent_xml_classifier_text,
+	[S(TEXT_SPACE)] = descent_xml_classifier_text_space,
+	[S(TEXT_ENTITY_START)] = descent_xml_classifier_text_entity_start,
+	[S(TEXT_ENTITY)] = descent_xml_classifier_text_entity,
+	[S(ELEMENT)] = descent_xml_classifier_element,
+	[S(ELEMENT_NAME)] = descent_xml_classifier_element_name,
+	[S(ELEMENT_SPACE)] = descent_xml_classifier_element_space,
+	[S(ELEMENT_EMPTY)] = descent_xml_classifier_element_empty,
+	[S(ELEMENT_END)] = descent_xml_classifier_element_end,
+	[S(ELEMENT_CLOSE)] = descent_xml_classifier_element_close,
+	[S(ELEMENT_CLOSE_NAME)] = descent_xml_classifier_element_close_name,
+	[S(ELEMENT_CLOSE_SPACE)] = descent_xml_classifier_element_close_space,
+	[S(ATTRIBUTE_NAME)] = descent_xml_classifier_attribute_name,
+	[S(ATTRIBUTE_EXPECT_ASSIGN)] = descent_xml_classifier_attribute_expect_assign,
+	[S(ATTRIBUTE_ASSIGN)] = descent_xml_classifier_attribute_assign,
+	[S(ATTRIBUTE_VALUE_SINGLE_QUOTE_START)] = descent_xml_classifier_attribute_value_single_quote_start,
+	[S(ATTRIBUTE_VALUE_SINGLE_QUOTE)] = descent_xml_classifier_attribute_value_single_quote,
+	[S(ATTRIBUTE_VALUE_SINGLE_QUOTE_END)] = descent_xml_classifier_attribute_value_single_quote_end,
+	[S(ATTRIBUTE_VALUE_SINGLE_QUOTE_ENTITY_START)] = descent_xml_classifier_attribute_value_single_quote_entity_start,
+	[S(ATTRIBUTE_VALUE_SINGLE_QUOTE_ENTITY)] = descent_xml_classifier_attribute_value_single_quote_entity,
+	[S(ATTRIBUTE_VALUE_DOUBLE_QUOTE_START)] = descent_xml_classifier_attribute_value_double_quote_start,
+	[S(ATTRIBUTE_VALUE_DOUBLE_QUOTE)] = descent_xml_classifier_attribute_value_double_quote,
+	[S(ATTRIBUTE_VALUE_DOUBLE_QUOTE_END)] = descent_xml_classifier_attribute_value_double_quote_end,
+	[S(ATTRIBUTE_VALUE_DOUBLE_QUOTE_ENTITY_START)] = descent_xml_classifier_attribute_value_double_quote_entity_start,
+	[S(ATTRIBUTE_VALUE_DOUBLE_QUOTE_ENTITY)] = descent_xml_classifier_attribute_value_double_quote_entity,
+};
+
+descent_xml_classifier_fn *descent_xml_classifier_state_fn(
+	enum descent_xml_classifier_state state
+)
+{
+	return state_fns[state];
+}
+
+// The table lexer looks up the state of every token it's given,
+// so the functions are kept in a hash table keyed on their
+// addresses. Addresses aren't known until the library is loaded,
+// so it's filled in on first use.
+enum { FN_STATE_SLOTS = 64 };
+
+_Static_assert(
+	FN_STATE_SLOTS >= 2 * DESCENT_XML_CLASSIFIER_STATE_COUNT,
+	"the function hash table should be at most half full"
+);
+
+static cfn *fn_state_keys[FN_STATE_SLOTS];
+static unsigned char fn_state_values[FN_STATE_SLOTS];
+static pthread_once_t fn_state_once = PTHREAD_ONCE_INIT;
+
+static size_t fn_state_slot(cfn *fn)
+{
+	const uint64_t hash = (uint64_t)(uintptr_t)fn * 0x9e3779b97f4a7c15u;
+	return (size_t)(hash >> 58) & (FN_STATE_SLOTS - 1);
+}
+
+static void fn_state_init(void)
+{
+	for (int state = 0; state < DESCENT_XML_CLASSIFIER_STATE_COUNT; state++) {
+		size_t slot = fn_state_slot(state_fns[state]);
+		while (fn_state_keys[slot])
+			slot = (slot + 1) & (FN_STATE_SLOTS - 1);
+		fn_state_keys[slot] = state_fns[state];
+		fn_state_values[slot] = (unsigned char)state;
+	}
+}
+
+enum descent_xml_classifier_state descent_xml_classifier_fn_state(
+	descent_xml_classifier_fn *fn
+)
+{
+	pthread_once(&fn_state_once, fn_state_init);
+	for (size_t slot = fn_state_slot(fn);; slot = (slot + 1) & (FN_STATE_SLOTS - 1)) {
+		if (fn_state_keys[slot] == fn)
+			return (enum descent_xml_classifier_state)fn_state_values[slot];
+		if (!fn_state_keys[slot])
+			return DESCENT_XML_CLASSIFIER_STATE_COUNT;
+	}
+}
+
+#undef S
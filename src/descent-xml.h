@@ -23,9 +23,16 @@
 extern "C" {
 #endif
 
+#include "descent-xml/arena.h"
 #include "descent-xml/classifier.h"
+#include "descent-xml/dispatch.h"
+#include "descent-xml/entity.h"
+#include "descent-xml/intern.h"
 #include "descent-xml/lex.h"
+#include "descent-xml/parallel.h"
 #include "descent-xml/parse.h"
+#include "descent-xml/scan.h"
+#include "descent-xml/stream.h"
 #include "descent-xml/validate.h"
 
 #ifdef __cplusplus
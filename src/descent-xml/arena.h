@@ -0,0 +1,240 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DESCENT_XML_ARENA
+#define DESCENT_XML_ARENA
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libadt/lptr.h>
+
+/**
+ * \file
+ *
+ * A bump allocator for short-lived strings, like the copies
+ * descent_xml_parse_cstr() hands to its callbacks.
+ *
+ * Memory is taken from a list of chunks, and given back all at
+ * once by resetting the arena to an earlier mark. Chunks are
+ * kept when the arena is reset, so an arena that's marked and
+ * reset around each use stops allocating once its chunks are
+ * big enough:
+ *
+ * ```
+ * struct descent_xml_arena arena = descent_xml_arena_init();
+ * const struct descent_xml_arena_mark mark = descent_xml_arena_mark(&arena);
+ * char *copy = descent_xml_arena_strndup(&arena, value);
+ * // ...
+ * descent_xml_arena_reset(&arena, mark);
+ * // ...
+ * descent_xml_arena_free(&arena);
+ * ```
+ */
+
+/**
+ * \brief The smallest chunk an arena allocates, in bytes,
+ * 	including the chunk's header.
+ */
+#define DESCENT_XML_ARENA_CHUNK 4096
+
+struct _descent_xml_arena_chunk {
+	struct _descent_xml_arena_chunk *next;
+	size_t capacity;
+	max_align_t data[];
+};
+
+/**
+ * \brief An arena. Initialize with descent_xml_arena_init()
+ * 	and release with descent_xml_arena_free().
+ */
+struct descent_xml_arena {
+	// The chunks in the order they're used, the one being
+	// allocated from, and how much of it is used. _current
+	// is NULL until the first allocation.
+	struct _descent_xml_arena_chunk *_first;
+	struct _descent_xml_arena_chunk *_current;
+	size_t _used;
+};
+
+/**
+ * \brief A point to reset an arena to, from
+ * 	descent_xml_arena_mark().
+ */
+struct descent_xml_arena_mark {
+	struct _descent_xml_arena_chunk *_chunk;
+	size_t _used;
+};
+
+/**
+ * \brief Initializes an empty arena.
+ *
+ * \returns The arena.
+ */
+inline struct descent_xml_arena descent_xml_arena_init(void)
+{
+	return (struct descent_xml_arena) { 0 };
+}
+
+/**
+ * \brief Releases all of an arena's chunks. Everything
+ * 	allocated from it becomes invalid.
+ *
+ * \param arena The arena to release.
+ */
+inline void descent_xml_arena_free(struct descent_xml_arena *arena)
+{
+	struct _descent_xml_arena_chunk *chunk = arena->_first;
+	while (chunk) {
+		struct _descent_xml_arena_chunk *const next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	*arena = descent_xml_arena_init();
+}
+
+/**
+ * \brief Records how much of an arena is in use.
+ *
+ * \param arena The arena.
+ *
+ * \returns A mark to pass to descent_xml_arena_reset().
+ */
+inline struct descent_xml_arena_mark descent_xml_arena_mark(
+	const struct descent_xml_arena *arena
+)
+{
+	return (struct descent_xml_arena_mark) {
+		._chunk = arena->_current,
+		._used = arena->_used,
+	};
+}
+
+/**
+ * \brief Frees everything allocated from an arena since a mark
+ * 	was taken. The memory is kept for later allocations.
+ *
+ * \param arena The arena.
+ * \param mark A mark taken from the arena, which hasn't been
+ * 	reset to an earlier mark since.
+ */
+inline void descent_xml_arena_reset(
+	struct descent_xml_arena *arena,
+	struct descent_xml_arena_mark mark
+)
+{
+	arena->_current = mark._chunk;
+	arena->_used = mark._used;
+}
+
+// Moves on to a chunk with room for size bytes: the next one
+// if it's big enough, or a new one inserted before it
+inline bool _descent_xml_arena_advance(
+	struct descent_xml_arena *arena,
+	size_t size
+)
+{
+	struct _descent_xml_arena_chunk **const link = arena->_current
+		? &arena->_current->next
+		: &arena->_first;
+
+	struct _descent_xml_arena_chunk *chunk = *link;
+	if (!chunk || chunk->capacity < size) {
+		const size_t header = offsetof(struct _descent_xml_arena_chunk, data);
+		size_t capacity = DESCENT_XML_ARENA_CHUNK - header;
+		if (capacity < size)
+			capacity = size;
+
+		chunk = malloc(header + capacity);
+		if (!chunk)
+			return false;
+		chunk->next = *link;
+		chunk->capacity = capacity;
+		*link = chunk;
+	}
+
+	arena->_current = chunk;
+	arena->_used = 0;
+	return true;
+}
+
+/**
+ * \brief Allocates memory from an arena, aligned for any type.
+ *
+ * \param arena The arena to allocate from.
+ * \param size The number of bytes to allocate.
+ *
+ * \returns A pointer to the memory, or NULL if a chunk
+ * 	couldn't be allocated.
+ */
+inline void *descent_xml_arena_alloc(
+	struct descent_xml_arena *arena,
+	size_t size
+)
+{
+	const size_t align = _Alignof(max_align_t);
+	size_t start = (arena->_used + align - 1) & ~(align - 1);
+	if (!arena->_current || start > arena->_current->capacity
+		|| arena->_current->capacity - start < size) {
+		if (!_descent_xml_arena_advance(arena, size))
+			return NULL;
+		start = 0;
+	}
+
+	arena->_used = start + size;
+	return (char *)arena->_current->data + start;
+}
+
+/**
+ * \brief Copies a string into an arena as a null-terminated
+ * 	string.
+ *
+ * \param arena The arena to allocate from.
+ * \param string The string to copy.
+ *
+ * \returns The copy, or NULL if a chunk couldn't be allocated.
+ */
+inline char *descent_xml_arena_strndup(
+	struct descent_xml_arena *arena,
+	struct libadt_const_lptr string
+)
+{
+	const size_t length = (size_t)string.length;
+	if (!arena->_current || arena->_current->capacity - arena->_used <= length) {
+		if (!_descent_xml_arena_advance(arena, length + 1))
+			return NULL;
+	}
+
+	char *const copy = (char *)arena->_current->data + arena->_used;
+	memcpy(copy, string.buffer, length);
+	copy[length] = '\0';
+	arena->_used += length + 1;
+	return copy;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // DESCENT_XML_ARENA
@@ -46,6 +46,7 @@ extern "C" {
  */
 
 #include <stddef.h>
+#include <wchar.h>
 
 /**
  * Type definition for a "void function".
@@ -141,6 +142,122 @@ descent_xml_classifier_void_fn *descent_xml_classifier_text_entity(wchar_t input
 
 descent_xml_classifier_void_fn *descent_xml_classifier_attribute_expect_assign(wchar_t input);
 
+/**
+ * \brief Dense numbering of the classifier states.
+ *
+ * Each value corresponds to the classifier function with
+ * the same name. This is used by the table-driven engine,
+ * where the state machine is a lookup into a transition
+ * table instead of an indirect function call: see
+ * descent_xml_classifier_next().
+ */
+enum descent_xml_classifier_state {
+	DESCENT_XML_CLASSIFIER_UNEXPECTED,
+	DESCENT_XML_CLASSIFIER_EOF,
+	DESCENT_XML_CLASSIFIER_START,
+	DESCENT_XML_CLASSIFIER_TEXT,
+	DESCENT_XML_CLASSIFIER_TEXT_SPACE,
+	DESCENT_XML_CLASSIFIER_TEXT_ENTITY_START,
+	DESCENT_XML_CLASSIFIER_TEXT_ENTITY,
+	DESCENT_XML_CLASSIFIER_ELEMENT,
+	DESCENT_XML_CLASSIFIER_ELEMENT_NAME,
+	DESCENT_XML_CLASSIFIER_ELEMENT_SPACE,
+	DESCENT_XML_CLASSIFIER_ELEMENT_EMPTY,
+	DESCENT_XML_CLASSIFIER_ELEMENT_END,
+	DESCENT_XML_CLASSIFIER_ELEMENT_CLOSE,
+	DESCENT_XML_CLASSIFIER_ELEMENT_CLOSE_NAME,
+	DESCENT_XML_CLASSIFIER_ELEMENT_CLOSE_SPACE,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_NAME,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_EXPECT_ASSIGN,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_ASSIGN,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_VALUE_SINGLE_QUOTE_START,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_VALUE_SINGLE_QUOTE,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_VALUE_SINGLE_QUOTE_END,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_VALUE_SINGLE_QUOTE_ENTITY_START,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_VALUE_SINGLE_QUOTE_ENTITY,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_VALUE_DOUBLE_QUOTE_START,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_VALUE_DOUBLE_QUOTE,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_VALUE_DOUBLE_QUOTE_END,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_VALUE_DOUBLE_QUOTE_ENTITY_START,
+	DESCENT_XML_CLASSIFIER_ATTRIBUTE_VALUE_DOUBLE_QUOTE_ENTITY,
+
+	/**
+	 * \brief The number of states.
+	 *
+	 * Also returned by descent_xml_classifier_fn_state()
+	 * for functions that aren't classifier states.
+	 */
+	DESCENT_XML_CLASSIFIER_STATE_COUNT,
+};
+
+/**
+ * \brief Returns the classifier function for a state.
+ *
+ * \param state The state to convert.
+ *
+ * \returns The classifier function, which compares equal
+ * 	to the `descent_xml_classifier_*` function of the
+ * 	same name.
+ */
+descent_xml_classifier_fn *descent_xml_classifier_state_fn(
+	enum descent_xml_classifier_state state
+);
+
+/**
+ * \brief Returns the state for a classifier function.
+ *
+ * \param fn The classifier function to convert.
+ *
+ * \returns The state, or DESCENT_XML_CLASSIFIER_STATE_COUNT if
+ * 	fn isn't one of the classifier's states.
+ */
+enum descent_xml_classifier_state descent_xml_classifier_fn_state(
+	descent_xml_classifier_fn *fn
+);
+
+// Internal tables for descent_xml_classifier_next().
+// Characters are sorted into classes, then the next
+// state is looked up by the current state and class.
+enum { _DESCENT_XML_CLASSIFIER_CLASS_COUNT = 19 };
+
+extern const unsigned char _descent_xml_classifier_byte_classes[256];
+
+extern const unsigned char _descent_xml_classifier_transitions
+	[DESCENT_XML_CLASSIFIER_STATE_COUNT]
+	[_DESCENT_XML_CLASSIFIER_CLASS_COUNT];
+
+unsigned char _descent_xml_classifier_wide_class(wchar_t input);
+
+/**
+ * \brief The table-driven equivalent of calling a classifier
+ * 	function.
+ *
+ * `descent_xml_classifier_next(state, input)` returns the
+ * state for the function that
+ * `descent_xml_classifier_state_fn(state)(input)` would
+ * return, without making an indirect call.
+ *
+ * Unlike the classifier functions, it's safe to pass
+ * DESCENT_XML_CLASSIFIER_UNEXPECTED and DESCENT_XML_CLASSIFIER_EOF:
+ * both return DESCENT_XML_CLASSIFIER_UNEXPECTED.
+ *
+ * \param state The current state.
+ * \param input The next input character.
+ *
+ * \returns The next state.
+ */
+inline enum descent_xml_classifier_state descent_xml_classifier_next(
+	enum descent_xml_classifier_state state,
+	wchar_t input
+)
+{
+	const unsigned char cclass = (wint_t)input < 256
+		? _descent_xml_classifier_byte_classes[input]
+		: _descent_xml_classifier_wide_class(input);
+	return (enum descent_xml_classifier_state)
+		_descent_xml_classifier_transitions[state][cclass];
+}
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
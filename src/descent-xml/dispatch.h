@@ -0,0 +1,301 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DESCENT_XML_DISPATCH
+#define DESCENT_XML_DISPATCH
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <libadt/lptr.h>
+
+#include "parse.h"
+
+/**
+ * \file
+ *
+ * Routes start tags to per-element handlers through a perfect
+ * hash table generated at build time, so each element costs
+ * one hash of its name and one comparison, however many names
+ * the vocabulary has.
+ *
+ * Tables are generated from a file listing one element name per
+ * line by the descent-xml-dispatch-gen tool. In CMake, the
+ * descent_xml_dispatch() function runs it for a target:
+ *
+ * ```
+ * descent_xml_dispatch(reader books books.txt)
+ * ```
+ *
+ * This generates `books.h`, which declares `enum books_name`
+ * with a `BOOKS_` constant for each name (in file order) and
+ * `BOOKS_COUNT`, along with the table `books_table`. Handlers
+ * are then given by name constant:
+ *
+ * ```
+ * descent_xml_parse_element_fn *handlers[BOOKS_COUNT] = {
+ * 	[BOOKS_BOOK] = book_handler,
+ * 	[BOOKS_AUTHOR] = author_handler,
+ * };
+ * struct descent_xml_dispatch dispatch = {
+ * 	.table = &books_table,
+ * 	.handlers = handlers,
+ * 	.context = &my_state,
+ * };
+ * token = descent_xml_parse(
+ * 	token,
+ * 	descent_xml_dispatch_element,
+ * 	text_handler,
+ * 	&dispatch
+ * );
+ * ```
+ *
+ * The table uses hash-and-displace: a name's hash picks a
+ * bucket, and the bucket's displacement, chosen by the
+ * generator so that no two names land together, picks its
+ * slot.
+ */
+
+/**
+ * \brief A perfect hash table of element names, as emitted by
+ * 	descent-xml-dispatch-gen.
+ */
+struct descent_xml_dispatch_table {
+	/**
+	 * \brief The seed the names were hashed with.
+	 */
+	uint32_t seed;
+
+	/**
+	 * \brief The number of entries in displacements.
+	 */
+	uint32_t buckets;
+
+	/**
+	 * \brief The number of entries in slots, minus one. The
+	 * 	number of slots is a power of two.
+	 */
+	uint32_t mask;
+
+	/**
+	 * \brief The displacement for each bucket.
+	 */
+	const uint32_t *displacements;
+
+	/**
+	 * \brief The ID of the name in each slot, or -1 for
+	 * 	empty slots.
+	 */
+	const int32_t *slots;
+
+	/**
+	 * \brief The names, indexed by ID.
+	 */
+	const struct libadt_const_lptr *names;
+
+	/**
+	 * \brief The number of names.
+	 */
+	size_t count;
+};
+
+/**
+ * \brief Hashes a name for a dispatch table.
+ *
+ * This is FNV-1a with a seeded offset basis, followed by a
+ * finalizer so that every bit of the result depends on every
+ * byte of the name.
+ *
+ * \param name The name to hash.
+ * \param seed The table's seed.
+ *
+ * \returns The hash.
+ */
+inline uint64_t descent_xml_dispatch_hash(
+	struct libadt_const_lptr name,
+	uint32_t seed
+)
+{
+	const unsigned char *const bytes = name.buffer;
+	uint64_t hash = 14695981039346656037u ^ seed;
+	for (ssize_t i = 0; i < name.length; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211u;
+	}
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdu;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+/**
+ * \brief Finds the slot a hash maps to.
+ *
+ * \param table The table to look in.
+ * \param hash The hash, from descent_xml_dispatch_hash() with
+ * 	table->seed.
+ * \param displacement The displacement of the hash's bucket.
+ *
+ * \returns The slot, at most table->mask.
+ */
+inline uint32_t descent_xml_dispatch_slot(
+	const struct descent_xml_dispatch_table *table,
+	uint64_t hash,
+	uint32_t displacement
+)
+{
+	uint32_t slot = (uint32_t)hash + displacement * 0x9e3779b9u;
+	slot ^= slot >> 16;
+	slot *= 0x85ebca6bu;
+	slot ^= slot >> 13;
+	return slot & table->mask;
+}
+
+/**
+ * \brief Finds the bucket a hash maps to.
+ *
+ * \param table The table to look in.
+ * \param hash The hash, from descent_xml_dispatch_hash() with
+ * 	table->seed.
+ *
+ * \returns The bucket, less than table->buckets.
+ */
+inline uint32_t descent_xml_dispatch_bucket(
+	const struct descent_xml_dispatch_table *table,
+	uint64_t hash
+)
+{
+	return (uint32_t)(hash >> 32) % table->buckets;
+}
+
+/**
+ * \brief Looks up a name's ID.
+ *
+ * \param table The table to look in.
+ * \param name The name to look up.
+ *
+ * \returns The name's ID, or -1 if it isn't in the table.
+ */
+inline ssize_t descent_xml_dispatch_find(
+	const struct descent_xml_dispatch_table *table,
+	struct libadt_const_lptr name
+)
+{
+	const uint64_t hash = descent_xml_dispatch_hash(name, table->seed);
+	const uint32_t bucket = descent_xml_dispatch_bucket(table, hash);
+	const uint32_t slot = descent_xml_dispatch_slot(
+		table,
+		hash,
+		table->displacements[bucket]
+	);
+	const int32_t id = table->slots[slot];
+	if (id < 0)
+		return -1;
+
+	const struct libadt_const_lptr candidate = table->names[id];
+	if (candidate.length != name.length
+		|| memcmp(candidate.buffer, name.buffer, (size_t)name.length))
+		return -1;
+
+	return id;
+}
+
+/**
+ * \brief The context for descent_xml_dispatch_element().
+ */
+struct descent_xml_dispatch {
+	/**
+	 * \brief The generated table to look names up in.
+	 */
+	const struct descent_xml_dispatch_table *table;
+
+	/**
+	 * \brief The handler for each name, indexed by ID. Names
+	 * 	with a NULL handler are handled by fallback.
+	 */
+	descent_xml_parse_element_fn *const *handlers;
+
+	/**
+	 * \brief The handler for names that aren't in the table
+	 * 	or have no handler of their own, or NULL to skip
+	 * 	them.
+	 */
+	descent_xml_parse_element_fn *fallback;
+
+	/**
+	 * \brief The context passed on to the handlers.
+	 */
+	void *context;
+};
+
+/**
+ * \brief An element handler that passes each element on to
+ * 	the handler for its name.
+ *
+ * Pass this to descent_xml_parse() or its variants along with
+ * a struct descent_xml_dispatch as the context.
+ *
+ * \param token The token after the element's start tag.
+ * \param element_name The element's name.
+ * \param attributes The element's attributes.
+ * \param empty Whether the element is self-closing.
+ * \param dispatch A pointer to a struct descent_xml_dispatch.
+ *
+ * \returns Whatever the chosen handler returns, or token if no
+ * 	handler was chosen.
+ */
+inline struct descent_xml_lex descent_xml_dispatch_element(
+	struct descent_xml_lex token,
+	struct libadt_const_lptr element_name,
+	struct libadt_const_lptr attributes,
+	bool empty,
+	void *dispatch
+)
+{
+	const struct descent_xml_dispatch *const routes = dispatch;
+	const ssize_t id = descent_xml_dispatch_find(
+		routes->table,
+		element_name
+	);
+
+	descent_xml_parse_element_fn *handler = routes->fallback;
+	if (id >= 0 && routes->handlers[id])
+		handler = routes->handlers[id];
+
+	if (!handler)
+		return token;
+
+	return handler(
+		token,
+		element_name,
+		attributes,
+		empty,
+		routes->context
+	);
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // DESCENT_XML_DISPATCH
@@ -0,0 +1,226 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DESCENT_XML_ENTITY
+#define DESCENT_XML_ENTITY
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <libadt/lptr.h>
+
+/**
+ * \file
+ *
+ * Decodes the entity and character references in text and
+ * attribute values, which the parser passes on as-is.
+ *
+ * Most values don't have any references, so the decoder first
+ * looks for an `&`, and returns values without one untouched,
+ * without copying them:
+ *
+ * ```
+ * char buffer[256];
+ * struct libadt_const_lptr decoded = text;
+ * if (text.length <= (ssize_t)sizeof(buffer))
+ * 	decoded = descent_xml_entity_decode(text, buffer);
+ * ```
+ */
+
+/**
+ * \brief The longest reference the decoder looks at, from the
+ * 	`&` to the `;`. Longer references are left as they are.
+ */
+#define DESCENT_XML_ENTITY_MAX 32
+
+// Writes code_point to buffer as UTF-8, returning the number
+// of bytes written, or 0 if it isn't a character XML allows
+inline size_t _descent_xml_entity_utf8(uint32_t code_point, char *buffer)
+{
+	const bool allowed = code_point == 0x9
+		|| code_point == 0xA
+		|| code_point == 0xD
+		|| (code_point >= 0x20 && code_point <= 0xD7FF)
+		|| (code_point >= 0xE000 && code_point <= 0xFFFD)
+		|| (code_point >= 0x10000 && code_point <= 0x10FFFF);
+	if (!allowed)
+		return 0;
+
+	unsigned char *const bytes = (unsigned char *)buffer;
+	if (code_point < 0x80) {
+		bytes[0] = (unsigned char)code_point;
+		return 1;
+	} else if (code_point < 0x800) {
+		bytes[0] = (unsigned char)(0xC0 | code_point >> 6);
+		bytes[1] = (unsigned char)(0x80 | (code_point & 0x3F));
+		return 2;
+	} else if (code_point < 0x10000) {
+		bytes[0] = (unsigned char)(0xE0 | code_point >> 12);
+		bytes[1] = (unsigned char)(0x80 | (code_point >> 6 & 0x3F));
+		bytes[2] = (unsigned char)(0x80 | (code_point & 0x3F));
+		return 3;
+	}
+	bytes[0] = (unsigned char)(0xF0 | code_point >> 18);
+	bytes[1] = (unsigned char)(0x80 | (code_point >> 12 & 0x3F));
+	bytes[2] = (unsigned char)(0x80 | (code_point >> 6 & 0x3F));
+	bytes[3] = (unsigned char)(0x80 | (code_point & 0x3F));
+	return 4;
+}
+
+// Decodes the reference between an `&` and a `;`, returning the
+// number of bytes written, or 0 if it isn't one the decoder knows
+inline size_t _descent_xml_entity_reference(
+	struct libadt_const_lptr name,
+	char *buffer
+)
+{
+	const char *const bytes = name.buffer;
+	const size_t length = (size_t)name.length;
+
+	if (length < 2 || bytes[0] != '#') {
+		static const struct {
+			const char *name;
+			size_t length;
+			char value;
+		} predefined[] = {
+			{ "amp", 3, '&' },
+			{ "lt", 2, '<' },
+			{ "gt", 2, '>' },
+			{ "quot", 4, '"' },
+			{ "apos", 4, '\'' },
+		};
+		for (size_t i = 0; i < sizeof(predefined) / sizeof(*predefined); i++) {
+			if (predefined[i].length == length
+				&& !memcmp(predefined[i].name, bytes, length)) {
+				*buffer = predefined[i].value;
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	const bool hex = bytes[1] == 'x';
+	size_t i = hex ? 2 : 1;
+	if (i == length)
+		return 0;
+
+	uint32_t code_point = 0;
+	for (; i < length; i++) {
+		const char c = bytes[i];
+		uint32_t digit;
+		if (c >= '0' && c <= '9')
+			digit = (uint32_t)(c - '0');
+		else if (hex && c >= 'a' && c <= 'f')
+			digit = (uint32_t)(c - 'a' + 10);
+		else if (hex && c >= 'A' && c <= 'F')
+			digit = (uint32_t)(c - 'A' + 10);
+		else
+			return 0;
+
+		code_point = code_point * (hex ? 16 : 10) + digit;
+		if (code_point > 0x10FFFF)
+			return 0;
+	}
+
+	return _descent_xml_entity_utf8(code_point, buffer);
+}
+
+/**
+ * \brief Decodes the references in a text node or attribute
+ * 	value.
+ *
+ * The five predefined entities (`&amp;`, `&lt;`, `&gt;`,
+ * `&quot;` and `&apos;`) and decimal and hexadecimal character
+ * references (`&#38;`, `&#x26;`) are decoded, with characters
+ * written as UTF-8. Other entities, which would need a DTD, and
+ * references to characters XML doesn't allow are left as they
+ * are.
+ *
+ * A decoded value is never longer than the original, so it can
+ * be decoded in place by passing its own memory as buffer.
+ *
+ * \param string The value to decode.
+ * \param buffer Where to write the decoded value, with room for
+ * 	at least string.length bytes. It isn't null-terminated.
+ *
+ * \returns string itself if it doesn't contain an `&`, without
+ * 	writing to buffer. Otherwise, the decoded value in buffer.
+ */
+inline struct libadt_const_lptr descent_xml_entity_decode(
+	struct libadt_const_lptr string,
+	char *buffer
+)
+{
+	const char *const bytes = string.buffer;
+	const size_t length = (size_t)string.length;
+	const char *amp = length ? memchr(bytes, '&', length) : NULL;
+	if (!amp)
+		return string;
+
+	size_t in = 0, out = 0;
+	while (amp) {
+		const size_t at = (size_t)(amp - bytes);
+		memmove(buffer + out, bytes + in, at - in);
+		out += at - in;
+
+		size_t window = length - at;
+		if (window > DESCENT_XML_ENTITY_MAX)
+			window = DESCENT_XML_ENTITY_MAX;
+		const char *const semicolon = memchr(amp, ';', window);
+
+		size_t written = 0;
+		if (semicolon) {
+			const struct libadt_const_lptr name = {
+				.buffer = amp + 1,
+				.size = sizeof(char),
+				.length = semicolon - amp - 1,
+			};
+			written = _descent_xml_entity_reference(name, buffer + out);
+		}
+
+		if (written) {
+			out += written;
+			in = (size_t)(semicolon - bytes) + 1;
+		} else {
+			buffer[out++] = '&';
+			in = at + 1;
+		}
+
+		amp = in < length ? memchr(bytes + in, '&', length - in) : NULL;
+	}
+	memmove(buffer + out, bytes + in, length - in);
+	out += length - in;
+
+	return (struct libadt_const_lptr) {
+		.buffer = buffer,
+		.size = sizeof(char),
+		.length = (ssize_t)out,
+	};
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // DESCENT_XML_ENTITY
@@ -0,0 +1,303 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DESCENT_XML_INTERN
+#define DESCENT_XML_INTERN
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libadt/lptr.h>
+
+/**
+ * \file
+ *
+ * A table giving each distinct name a small integer ID, so
+ * handlers can switch on an ID instead of comparing strings.
+ *
+ * IDs are handed out in order from 0, so names added to a
+ * table before parsing get IDs that are known in advance:
+ *
+ * ```
+ * enum { BOOK, AUTHOR };
+ * struct descent_xml_intern names = descent_xml_intern_init();
+ * descent_xml_intern_add(&names, libadt_str_literal("book"));   // 0
+ * descent_xml_intern_add(&names, libadt_str_literal("author")); // 1
+ * ```
+ *
+ * Names are copied into the table, and looked up in an
+ * open-addressing hash table keyed on their bytes.
+ */
+
+/**
+ * \brief A table of interned names.
+ *
+ * Initialize with descent_xml_intern_init() and release
+ * with descent_xml_intern_free().
+ */
+struct descent_xml_intern {
+	/**
+	 * \brief The number of names in the table. Each name's
+	 * 	ID is less than this.
+	 */
+	size_t count;
+
+	// The names, end to end, and where each one ends,
+	// indexed by ID
+	char *_names;
+	size_t _names_length;
+	size_t _names_capacity;
+	size_t *_ends;
+	uint32_t *_hashes;
+	size_t _ids_capacity;
+
+	// The hash table: each slot is an ID plus one, or 0
+	// if the slot is empty. The capacity is a power of two.
+	size_t *_slots;
+	size_t _slots_capacity;
+};
+
+/**
+ * \brief Initializes an empty table.
+ *
+ * \returns The table.
+ */
+inline struct descent_xml_intern descent_xml_intern_init(void)
+{
+	return (struct descent_xml_intern) { 0 };
+}
+
+/**
+ * \brief Releases the memory held by a table.
+ *
+ * \param table The table to release.
+ */
+inline void descent_xml_intern_free(struct descent_xml_intern *table)
+{
+	free(table->_names);
+	free(table->_ends);
+	free(table->_hashes);
+	free(table->_slots);
+	*table = descent_xml_intern_init();
+}
+
+// FNV-1a
+inline uint32_t _descent_xml_intern_hash(struct libadt_const_lptr name)
+{
+	const unsigned char *const bytes = name.buffer;
+	uint32_t hash = 2166136261u;
+	for (ssize_t i = 0; i < name.length; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * \brief Returns the name with the given ID.
+ *
+ * \param table The table to look in.
+ * \param id The ID, less than table->count.
+ *
+ * \returns The name. This points into the table, and is only
+ * 	valid until the next name is added.
+ */
+inline struct libadt_const_lptr descent_xml_intern_name(
+	const struct descent_xml_intern *table,
+	size_t id
+)
+{
+	const size_t start = id ? table->_ends[id - 1] : 0;
+	return (struct libadt_const_lptr) {
+		.buffer = table->_names + start,
+		.size = sizeof(char),
+		.length = (ssize_t)(table->_ends[id] - start),
+	};
+}
+
+// Returns the index of the slot holding name, or of the
+// empty slot where it would go. There must be at least
+// one empty slot.
+inline size_t _descent_xml_intern_probe(
+	const struct descent_xml_intern *table,
+	struct libadt_const_lptr name,
+	uint32_t hash
+)
+{
+	const size_t mask = table->_slots_capacity - 1;
+	for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+		const size_t entry = table->_slots[slot];
+		if (!entry)
+			return slot;
+
+		const size_t id = entry - 1;
+		if (table->_hashes[id] != hash)
+			continue;
+
+		const struct libadt_const_lptr existing
+			= descent_xml_intern_name(table, id);
+		const bool equal = existing.length == name.length
+			&& memcmp(existing.buffer, name.buffer, (size_t)name.length) == 0;
+		if (equal)
+			return slot;
+	}
+}
+
+/**
+ * \brief Looks up a name's ID, without adding it.
+ *
+ * \param table The table to look in.
+ * \param name The name to look up.
+ *
+ * \returns The name's ID, or -1 if it isn't in the table.
+ */
+inline ssize_t descent_xml_intern_find(
+	const struct descent_xml_intern *table,
+	struct libadt_const_lptr name
+)
+{
+	if (!table->count)
+		return -1;
+
+	const size_t slot = _descent_xml_intern_probe(
+		table,
+		name,
+		_descent_xml_intern_hash(name)
+	);
+	return (ssize_t)table->_slots[slot] - 1;
+}
+
+// Puts an ID in the first empty slot for its hash
+inline void _descent_xml_intern_place(
+	struct descent_xml_intern *table,
+	size_t id
+)
+{
+	const size_t mask = table->_slots_capacity - 1;
+	size_t slot = table->_hashes[id] & mask;
+	while (table->_slots[slot])
+		slot = (slot + 1) & mask;
+	table->_slots[slot] = id + 1;
+}
+
+inline bool _descent_xml_intern_grow_slots(struct descent_xml_intern *table)
+{
+	const size_t capacity = table->_slots_capacity
+		? table->_slots_capacity * 2
+		: 16;
+	size_t *const slots = calloc(capacity, sizeof(*slots));
+	if (!slots)
+		return false;
+
+	free(table->_slots);
+	table->_slots = slots;
+	table->_slots_capacity = capacity;
+
+	for (size_t id = 0; id < table->count; id++)
+		_descent_xml_intern_place(table, id);
+	return true;
+}
+
+inline bool _descent_xml_intern_reserve(
+	struct descent_xml_intern *table,
+	size_t length
+)
+{
+	if (table->_names_length + length > table->_names_capacity) {
+		size_t capacity = table->_names_capacity
+			? table->_names_capacity * 2
+			: 256;
+		while (capacity < table->_names_length + length)
+			capacity *= 2;
+		char *const names = realloc(table->_names, capacity);
+		if (!names)
+			return false;
+		table->_names = names;
+		table->_names_capacity = capacity;
+	}
+
+	if (table->count == table->_ids_capacity) {
+		const size_t capacity = table->_ids_capacity
+			? table->_ids_capacity * 2
+			: 32;
+		size_t *const ends = realloc(
+			table->_ends,
+			capacity * sizeof(*ends)
+		);
+		if (!ends)
+			return false;
+		table->_ends = ends;
+
+		uint32_t *const hashes = realloc(
+			table->_hashes,
+			capacity * sizeof(*hashes)
+		);
+		if (!hashes)
+			return false;
+		table->_hashes = hashes;
+		table->_ids_capacity = capacity;
+	}
+
+	// keep the table at most half full
+	if ((table->count + 1) * 2 > table->_slots_capacity)
+		return _descent_xml_intern_grow_slots(table);
+	return true;
+}
+
+/**
+ * \brief Returns a name's ID, adding it to the table if it
+ * 	isn't there already.
+ *
+ * \param table The table to add to.
+ * \param name The name to add.
+ *
+ * \returns The name's ID, or -1 if the table couldn't grow.
+ */
+inline ssize_t descent_xml_intern_add(
+	struct descent_xml_intern *table,
+	struct libadt_const_lptr name
+)
+{
+	const ssize_t found = descent_xml_intern_find(table, name);
+	if (found >= 0)
+		return found;
+
+	const size_t length = (size_t)name.length;
+	if (!_descent_xml_intern_reserve(table, length))
+		return -1;
+
+	const size_t id = table->count++;
+	memcpy(table->_names + table->_names_length, name.buffer, length);
+	table->_names_length += length;
+	table->_ends[id] = table->_names_length;
+	table->_hashes[id] = _descent_xml_intern_hash(name);
+	_descent_xml_intern_place(table, id);
+	return (ssize_t)id;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // DESCENT_XML_INTERN
@@ -25,12 +25,16 @@ extern "C" {
 
 
 
+#include <stdint.h>
+#include <string.h>
 #include <wchar.h>
 #include <wctype.h>
 
 #include <libadt.h>
 
+#include "descent-xml/config.h"
 #include "classifier.h"
+#include "scan.h"
 
 /**
  * \file
@@ -58,6 +62,69 @@ struct descent_xml_lex {
 	struct libadt_const_lptr value;
 };
 
+// Decodes a single UTF-8 character without going through
+// the C library. Returns the same things mbrtowc() does:
+// the number of bytes read, 0 for a null character, -1 for
+// an invalid sequence, or -2 for a sequence cut off by the
+// end of the string.
+inline ssize_t _descent_xml_lex_utf8_decode(
+	wchar_t *result,
+	struct libadt_const_lptr string
+)
+{
+	if (string.length <= 0) {
+		*result = L'\0';
+		return 0;
+	}
+
+	const unsigned char *const bytes = string.buffer;
+	const unsigned char lead = bytes[0];
+	if (lead < 0x80) {
+		*result = (wchar_t)lead;
+		return lead != 0;
+	}
+
+	// Sequence lengths by the top five bits of the lead byte:
+	// continuation bytes and 0xF8 up can't start a sequence
+	static const unsigned char lengths[32] = {
+		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+		0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 3, 3, 4, 0,
+	};
+	// The smallest character each length can encode,
+	// anything lower is an overlong encoding
+	static const uint32_t minimums[5] = {
+		0, 0, 0x80, 0x800, 0x10000,
+	};
+
+	const ssize_t length = lengths[lead >> 3];
+	if (!length)
+		return -1;
+
+	const ssize_t available = string.length < length
+		? string.length
+		: length;
+	uint32_t c = lead & (0x7Fu >> length);
+	unsigned char bad = 0;
+	for (ssize_t i = 1; i < available; i++) {
+		c = (c << 6) | (bytes[i] & 0x3Fu);
+		bad |= (bytes[i] & 0xC0) ^ 0x80;
+	}
+
+	if (bad)
+		return -1;
+	if (available < length)
+		return -2;
+
+	const bool invalid = c < minimums[length]
+		|| c > 0x10FFFF
+		|| (0xD800 <= c && c <= 0xDFFF);
+	if (invalid)
+		return -1;
+
+	*result = (wchar_t)c;
+	return length;
+}
+
 inline ssize_t _descent_xml_lex_mbrtowc(
 	wchar_t *result,
 	struct libadt_const_lptr string,
@@ -68,6 +135,16 @@ inline ssize_t _descent_xml_lex_mbrtowc(
 		*result = L'\0';
 		return 0;
 	}
+
+	// Fast path: every encoding we can sensibly parse XML in
+	// is ASCII-compatible, so single bytes below 0x80 are
+	// their own character and don't need a trip through libc
+	const unsigned char byte = *(const unsigned char *)string.buffer;
+	if (byte < 0x80) {
+		*result = (wchar_t)byte;
+		return byte != 0;
+	}
+
 	return (ssize_t)mbrtowc(
 		result,
 		string.buffer,
@@ -76,6 +153,22 @@ inline ssize_t _descent_xml_lex_mbrtowc(
 	);
 }
 
+// Decodes the character at the start of string, with the
+// built-in UTF-8 decoder or, if the library was built with
+// DESCENT_XML_LOCALE_DECODER, with the LC_CTYPE locale.
+inline ssize_t _descent_xml_lex_decode(
+	wchar_t *result,
+	struct libadt_const_lptr string
+)
+{
+#ifdef DESCENT_XML_LOCALE_DECODER
+	mbstate_t mbs = { 0 };
+	return _descent_xml_lex_mbrtowc(result, string, &mbs);
+#else
+	return _descent_xml_lex_utf8_decode(result, string);
+#endif
+}
+
 typedef struct {
 	ssize_t amount;
 	descent_xml_classifier_fn *type;
@@ -94,9 +187,8 @@ inline _descent_xml_lex_read_t _descent_xml_lex_read(
 )
 {
 	wchar_t c = 0;
-	mbstate_t mbs = { 0 };
 	_descent_xml_lex_read_t result = { 0 };
-	result.amount = _descent_xml_lex_mbrtowc(&c, script, &mbs);
+	result.amount = _descent_xml_lex_decode(&c, script);
 	if (_descent_xml_lex_read_error(result))
 		result.type = (descent_xml_classifier_fn*)descent_xml_classifier_unexpected;
 	else
@@ -106,11 +198,35 @@ inline _descent_xml_lex_read_t _descent_xml_lex_read(
 	return result;
 }
 
+// Skips over the bytes that can't take a token out of the
+// given state, without classifying them one at a time
+inline ssize_t _descent_xml_lex_skip(
+	struct libadt_const_lptr script,
+	descent_xml_classifier_fn *const type
+)
+{
+	if (type == descent_xml_classifier_text)
+		return descent_xml_scan_text(script);
+	if (type == descent_xml_classifier_text_space)
+		return descent_xml_scan_space(script);
+	if (type == descent_xml_classifier_attribute_value_double_quote)
+		return descent_xml_scan_attribute_value(script, '"');
+	if (type == descent_xml_classifier_attribute_value_single_quote)
+		return descent_xml_scan_attribute_value(script, '\'');
+	return 0;
+}
+
 descent_xml_classifier_void_fn *descent_xml_lex_doctype(wchar_t input);
 descent_xml_classifier_void_fn *descent_xml_lex_xmldecl(wchar_t input);
 descent_xml_classifier_void_fn *descent_xml_lex_cdata(wchar_t input);
 descent_xml_classifier_void_fn *descent_xml_lex_comment(wchar_t input);
 
+/**
+ * \brief The token type returned by descent_xml_lex_push_next()
+ * 	when the buffer ends before the next token does.
+ */
+descent_xml_classifier_void_fn *descent_xml_lex_need_input(wchar_t input);
+
 /**
  * \brief Initializes a token object for use in descent_xml_lex_next().
  *
@@ -145,18 +261,31 @@ inline bool _descent_xml_lex_startswith(
 	);
 }
 
+inline bool _descent_xml_lex_iswspace(wchar_t c)
+{
+	// same ASCII fast path as _descent_xml_lex_mbrtowc()
+	if ((wint_t)c < 0x80)
+		return c == L' '
+			|| (L'\t' <= c && c <= L'\r');
+#ifdef DESCENT_XML_LOCALE_DECODER
+	return iswspace((wint_t)c);
+#else
+	// XML only counts ASCII whitespace
+	return false;
+#endif
+}
+
 inline ssize_t _descent_xml_lex_count_spaces(
 	struct libadt_const_lptr next
 )
 {
 	ssize_t spaces = 0;
 	wchar_t c = 0;
-	mbstate_t mbstate = { 0 };
 	for (
-		ssize_t current = _descent_xml_lex_mbrtowc(&c, next, &mbstate);
-		iswspace((wint_t)c);
+		ssize_t current = _descent_xml_lex_decode(&c, next);
+		_descent_xml_lex_iswspace(c);
 		next = libadt_const_lptr_index(next, current),
-		current = _descent_xml_lex_mbrtowc(&c, next, &mbstate)
+		current = _descent_xml_lex_decode(&c, next)
 	) {
 		const bool unexpected = c == L'\0'
 			|| current < 0;
@@ -318,7 +447,13 @@ inline struct descent_xml_lex _descent_xml_lex_quote_string(
 
 		total += read.amount;
 
-		read = _descent_xml_lex_read(read.script, read.type);
+		const ssize_t skipped = _descent_xml_lex_skip(read.script, read.type);
+		total += skipped;
+
+		read = _descent_xml_lex_read(
+			libadt_const_lptr_index(read.script, skipped),
+			read.type
+		);
 		end_quote
 			= read.type == descent_xml_classifier_attribute_value_single_quote_end
 			|| read.type == descent_xml_classifier_attribute_value_double_quote_end;
@@ -531,19 +666,13 @@ inline struct descent_xml_lex descent_xml_lex_handle_cdata(
 	total += cdata.length;
 	remainder = libadt_const_lptr_index(remainder, cdata.length);
 
-	const struct libadt_const_lptr cdata_end
-		= libadt_str_literal("]]");
-
-	while (!_descent_xml_lex_startswith(remainder, cdata_end)) {
-		if (remainder.length <= 0) {
-			token.type = descent_xml_classifier_unexpected;
-			return token;
-		}
-		total++;
-		remainder = libadt_const_lptr_index(remainder, 1);
+	const ssize_t end = descent_xml_scan_pair(remainder, ']', ']');
+	if (end < 0) {
+		token.type = descent_xml_classifier_unexpected;
+		return token;
 	}
 
-	total += cdata_end.length;
+	total += end + 2 /* ]] */;
 	token.type = descent_xml_lex_cdata;
 	token.value = libadt_const_lptr_index(token.value, 1);
 	token.value.length += total;
@@ -567,19 +696,13 @@ inline struct descent_xml_lex descent_xml_lex_handle_comment(
 	total += comment.length;
 	remainder = libadt_const_lptr_index(remainder, comment.length);
 
-	const struct libadt_const_lptr comment_end
-		= libadt_str_literal("--");
-
-	while (!_descent_xml_lex_startswith(remainder, comment_end)) {
-		if (remainder.length <= 0) {
-			token.type = descent_xml_classifier_unexpected;
-			return token;
-		}
-		total++;
-		remainder = libadt_const_lptr_index(remainder, 1);
+	const ssize_t end = descent_xml_scan_pair(remainder, '-', '-');
+	if (end < 0) {
+		token.type = descent_xml_classifier_unexpected;
+		return token;
 	}
 
-	total += comment_end.length;
+	total += end + 2 /* -- */;
 	token.type = descent_xml_lex_comment;
 	token.value = libadt_const_lptr_index(token.value, 1);
 	token.value.length += total;
@@ -597,31 +720,46 @@ inline struct descent_xml_lex _descent_xml_lex_handle_unmarkdown(
 	);
 }
 
+// Handles the sections after a '<' that can't be
+// lexed one character at a time. Returns an unexpected
+// token if there isn't one.
+inline struct descent_xml_lex _descent_xml_lex_next_markup(
+	struct descent_xml_lex token
+)
+{
+	if (token.type != descent_xml_classifier_element) {
+		token.type = descent_xml_classifier_unexpected;
+		return token;
+	}
+
+	// all this bizarre XML syntax pisses me off so
+	// I'm just beating it into submission
+	return descent_xml_lex_or(
+		token,
+		_descent_xml_lex_handle_prolog,
+		_descent_xml_lex_handle_unmarkdown
+	);
+}
+
 /**
- * \brief Returns the next, raw token in the script referred to by
- * 	previous.
+ * \brief The classifier function engine for descent_xml_lex_next_raw().
  *
- * \param previous The previous token from the script.
+ * Calls the classifier state functions through their pointers
+ * for each character.
+ *
+ * \param token The previous token from the script.
  *
  * \returns The next token.
  */
-inline struct descent_xml_lex descent_xml_lex_next_raw(
+inline struct descent_xml_lex descent_xml_lex_next_raw_fn(
 	struct descent_xml_lex token
 )
 {
 	struct libadt_const_lptr next = _descent_xml_lex_remainder(token);
 
-	if (token.type == descent_xml_classifier_element) {
-		// all this bizarre XML syntax pisses me off so
-		// I'm just beating it into submission
-		struct descent_xml_lex test = descent_xml_lex_or(
-			token,
-			_descent_xml_lex_handle_prolog,
-			_descent_xml_lex_handle_unmarkdown
-		);
-		if (test.type != descent_xml_classifier_unexpected)
-			return test;
-	}
+	struct descent_xml_lex test = _descent_xml_lex_next_markup(token);
+	if (test.type != descent_xml_classifier_unexpected)
+		return test;
 
 	_descent_xml_lex_read_t
 		read = _descent_xml_lex_read(next, token.type),
@@ -643,11 +781,16 @@ inline struct descent_xml_lex descent_xml_lex_next_raw(
 	}
 
 	ssize_t value_length = read.amount;
-	for (
-		read = _descent_xml_lex_read(read.script, read.type);
-		!_descent_xml_lex_read_error(read);
-		read = _descent_xml_lex_read(read.script, read.type)
-	) {
+	for (;;) {
+		const ssize_t skipped = _descent_xml_lex_skip(read.script, read.type);
+		value_length += skipped;
+
+		read = _descent_xml_lex_read(
+			libadt_const_lptr_index(read.script, skipped),
+			read.type
+		);
+		if (_descent_xml_lex_read_error(read))
+			break;
 		if (read.type != previous_read.type)
 			break;
 
@@ -662,6 +805,649 @@ inline struct descent_xml_lex descent_xml_lex_next_raw(
 	};
 }
 
+/**
+ * \brief The transition table engine for descent_xml_lex_next_raw().
+ *
+ * Converts the token's type to a descent_xml_classifier_state
+ * once, then steps through the state machine with
+ * descent_xml_classifier_next(), converting back for the
+ * returned token. Tokens of types the classifier doesn't
+ * know about, like descent_xml_lex_doctype, are passed on to
+ * descent_xml_lex_next_raw_fn().
+ *
+ * \param token The previous token from the script.
+ *
+ * \returns The next token. This is the same token
+ * 	descent_xml_lex_next_raw_fn() would return.
+ */
+inline struct descent_xml_lex descent_xml_lex_next_raw_table(
+	struct descent_xml_lex token
+)
+{
+	const enum descent_xml_classifier_state previous
+		= descent_xml_classifier_fn_state(token.type);
+	if (previous == DESCENT_XML_CLASSIFIER_STATE_COUNT)
+		return descent_xml_lex_next_raw_fn(token);
+
+	struct libadt_const_lptr next = _descent_xml_lex_remainder(token);
+
+	struct descent_xml_lex test = _descent_xml_lex_next_markup(token);
+	if (test.type != descent_xml_classifier_unexpected)
+		return test;
+
+	wchar_t c = 0;
+	ssize_t amount = _descent_xml_lex_decode(&c, next);
+	const enum descent_xml_classifier_state state = amount < 0
+		? DESCENT_XML_CLASSIFIER_UNEXPECTED
+		: descent_xml_classifier_next(previous, c);
+
+	if (state == DESCENT_XML_CLASSIFIER_UNEXPECTED)
+		return (struct descent_xml_lex) {
+			.script = token.script,
+			.type = descent_xml_classifier_unexpected,
+			.value = libadt_const_lptr_truncate(next, 0),
+		};
+
+	if (state == DESCENT_XML_CLASSIFIER_EOF)
+		return (struct descent_xml_lex) {
+			.script = token.script,
+			.type = descent_xml_classifier_eof,
+			.value = libadt_const_lptr_truncate(next, (size_t)amount),
+		};
+
+	descent_xml_classifier_fn *const type
+		= descent_xml_classifier_state_fn(state);
+	ssize_t value_length = amount;
+	for (;;) {
+		struct libadt_const_lptr remainder
+			= libadt_const_lptr_index(next, value_length);
+		const ssize_t skipped = _descent_xml_lex_skip(remainder, type);
+		value_length += skipped;
+		remainder = libadt_const_lptr_index(remainder, skipped);
+
+		amount = _descent_xml_lex_decode(&c, remainder);
+		if (amount < 0)
+			break;
+		if (descent_xml_classifier_next(state, c) != state)
+			break;
+
+		value_length += amount;
+	}
+
+	return (struct descent_xml_lex) {
+		.script = token.script,
+		.type = type,
+		.value = libadt_const_lptr_truncate(next, (size_t)value_length),
+	};
+}
+
+/**
+ * \brief Returns the next, raw token in the script referred to by
+ * 	previous.
+ *
+ * This uses descent_xml_lex_next_raw_fn() by default, or
+ * descent_xml_lex_next_raw_table() if the library was built
+ * with the `DESCENT_XML_TABLE_LEXER` CMake option.
+ *
+ * \param previous The previous token from the script.
+ *
+ * \returns The next token.
+ */
+inline struct descent_xml_lex descent_xml_lex_next_raw(
+	struct descent_xml_lex token
+)
+{
+#ifdef DESCENT_XML_TABLE_LEXER
+	return descent_xml_lex_next_raw_table(token);
+#else
+	return descent_xml_lex_next_raw_fn(token);
+#endif
+}
+
+/**
+ * \brief Storage for descent_xml_lex_next_batch().
+ *
+ * Tokens are stored as parallel arrays, instead of as an array
+ * of struct descent_xml_lex: the script is the same for every
+ * token in a batch, so each one only needs its type and where
+ * its value is.
+ *
+ * The arrays are provided by the caller, and must each have
+ * room for at least as many elements as the capacity passed
+ * to descent_xml_lex_next_batch().
+ */
+struct descent_xml_lex_batch {
+	/**
+	 * \brief The type of each token.
+	 */
+	descent_xml_classifier_fn **type;
+
+	/**
+	 * \brief The offset of each token's value from the
+	 * 	start of the script, in bytes.
+	 */
+	size_t *offset;
+
+	/**
+	 * \brief The length of each token's value, in bytes.
+	 */
+	size_t *length;
+
+	/**
+	 * \brief The number of tokens filled in by the last
+	 * 	call to descent_xml_lex_next_batch().
+	 */
+	size_t count;
+};
+
+/**
+ * \brief Lexes up to capacity tokens into batch.
+ *
+ * This is equivalent to calling descent_xml_lex_next_raw()
+ * capacity times and storing each result, but stops early
+ * after storing a descent_xml_classifier_eof or
+ * descent_xml_classifier_unexpected token.
+ *
+ * \param token The previous token from the script.
+ * \param batch The arrays to store tokens in. batch->count
+ * 	is set to the number of tokens stored.
+ * \param capacity The number of elements in each of
+ * 	batch's arrays.
+ *
+ * \returns The last token stored, which can be passed back
+ * 	in to continue lexing, or token if capacity was 0.
+ */
+inline struct descent_xml_lex descent_xml_lex_next_batch(
+	struct descent_xml_lex token,
+	struct descent_xml_lex_batch *batch,
+	size_t capacity
+)
+{
+	const char *const script = token.script.buffer;
+	size_t count = 0;
+
+	while (count < capacity) {
+		token = descent_xml_lex_next_raw(token);
+
+		batch->type[count] = token.type;
+		batch->offset[count] = (size_t)((const char *)token.value.buffer - script);
+		batch->length[count] = (size_t)token.value.length;
+		count++;
+
+		const bool done = token.type == descent_xml_classifier_eof
+			|| token.type == descent_xml_classifier_unexpected;
+		if (done)
+			break;
+	}
+
+	batch->count = count;
+	return token;
+}
+
+/**
+ * \brief Rebuilds a token stored by descent_xml_lex_next_batch().
+ *
+ * \param token Any token from the same script as the batch,
+ * 	such as the one returned by descent_xml_lex_next_batch().
+ * \param batch The batch to read from.
+ * \param index The index of the token to rebuild, less
+ * 	than batch.count.
+ *
+ * \returns The token at index.
+ */
+inline struct descent_xml_lex descent_xml_lex_batch_get(
+	struct descent_xml_lex token,
+	struct descent_xml_lex_batch batch,
+	size_t index
+)
+{
+	const struct libadt_const_lptr value = libadt_const_lptr_index(
+		token.script,
+		(ssize_t)batch.offset[index]
+	);
+	return (struct descent_xml_lex) {
+		.type = batch.type[index],
+		.script = token.script,
+		.value = libadt_const_lptr_truncate(value, batch.length[index]),
+	};
+}
+
+/**
+ * \brief Numbers for every token type, for storing in
+ * 	struct descent_xml_lex_compact.
+ *
+ * Values below DESCENT_XML_CLASSIFIER_STATE_COUNT are
+ * the enum descent_xml_classifier_state values; these
+ * continue on from there for the types only the lexer
+ * produces.
+ */
+enum descent_xml_lex_type {
+	DESCENT_XML_LEX_DOCTYPE = DESCENT_XML_CLASSIFIER_STATE_COUNT,
+	DESCENT_XML_LEX_XMLDECL,
+	DESCENT_XML_LEX_CDATA,
+	DESCENT_XML_LEX_COMMENT,
+	DESCENT_XML_LEX_NEED_INPUT,
+
+	/**
+	 * \brief The number of token types.
+	 */
+	DESCENT_XML_LEX_TYPE_COUNT,
+};
+
+/**
+ * \brief Returns the number for a token type.
+ *
+ * \param type The token type to convert.
+ *
+ * \returns Either an enum descent_xml_classifier_state or
+ * 	an enum descent_xml_lex_type value, or
+ * 	DESCENT_XML_CLASSIFIER_UNEXPECTED if type isn't a
+ * 	type the lexer produces.
+ */
+unsigned char descent_xml_lex_type_id(descent_xml_classifier_fn *type);
+
+/**
+ * \brief Returns the token type for a number returned by
+ * 	descent_xml_lex_type_id().
+ *
+ * \param id The number to convert.
+ *
+ * \returns The token type, or descent_xml_classifier_unexpected
+ * 	if id is out of range.
+ */
+descent_xml_classifier_fn *descent_xml_lex_type_fn(unsigned char id);
+
+/**
+ * \brief A token without its script.
+ *
+ * This takes 16 bytes instead of the 56 a struct descent_xml_lex
+ * takes, for storing large numbers of tokens from the same
+ * script. Convert with descent_xml_lex_to_compact() and
+ * descent_xml_lex_from_compact().
+ */
+struct descent_xml_lex_compact {
+	/**
+	 * \brief The offset of the value from the start of
+	 * 	the script, in bytes.
+	 */
+	uint64_t offset;
+
+	/**
+	 * \brief The length of the value, in bytes.
+	 */
+	uint32_t length;
+
+	/**
+	 * \brief The token's type, as returned by
+	 * 	descent_xml_lex_type_id().
+	 */
+	uint8_t type;
+};
+
+/**
+ * \brief Converts a token to its compact form.
+ *
+ * \param token The token to convert.
+ *
+ * \returns The compact token. If token's value is too long
+ * 	to store in a 32-bit length, the result has the type
+ * 	DESCENT_XML_CLASSIFIER_UNEXPECTED and a length of 0.
+ */
+inline struct descent_xml_lex_compact descent_xml_lex_to_compact(
+	struct descent_xml_lex token
+)
+{
+	const uint64_t offset = (uint64_t)(
+		(const char *)token.value.buffer
+		- (const char *)token.script.buffer
+	);
+	if ((uint64_t)token.value.length > UINT32_MAX)
+		return (struct descent_xml_lex_compact) {
+			.offset = offset,
+			.type = DESCENT_XML_CLASSIFIER_UNEXPECTED,
+		};
+
+	return (struct descent_xml_lex_compact) {
+		.offset = offset,
+		.length = (uint32_t)token.value.length,
+		.type = descent_xml_lex_type_id(token.type),
+	};
+}
+
+/**
+ * \brief Converts a compact token back to a full token.
+ *
+ * \param script The script the token was lexed from.
+ * \param compact The compact token to convert.
+ *
+ * \returns The full token.
+ */
+inline struct descent_xml_lex descent_xml_lex_from_compact(
+	struct libadt_const_lptr script,
+	struct descent_xml_lex_compact compact
+)
+{
+	const struct libadt_const_lptr value
+		= libadt_const_lptr_index(script, (ssize_t)compact.offset);
+	return (struct descent_xml_lex) {
+		.type = descent_xml_lex_type_fn(compact.type),
+		.script = script,
+		.value = libadt_const_lptr_truncate(value, compact.length),
+	};
+}
+
+/**
+ * \brief The state of a push lexer, for lexing a script that
+ * 	arrives a piece at a time.
+ *
+ * Positions are kept as offsets from the start of the script,
+ * rather than pointers, so the buffer holding the script can be
+ * reallocated between calls to descent_xml_lex_push_next().
+ *
+ * Initialize with descent_xml_lex_push_init().
+ */
+struct descent_xml_lex_push {
+	/**
+	 * \brief The type of the last token returned.
+	 */
+	descent_xml_classifier_fn *type;
+
+	/**
+	 * \brief The offset of the last token's value.
+	 */
+	size_t offset;
+
+	/**
+	 * \brief The length of the last token's value.
+	 */
+	size_t length;
+
+	/**
+	 * \brief The type of the token that was cut off by the
+	 * 	end of the buffer, or NULL if there isn't one.
+	 */
+	descent_xml_classifier_fn *pending;
+
+	/**
+	 * \brief The number of bytes of the pending token that
+	 * 	have already been lexed.
+	 */
+	size_t scanned;
+
+	/**
+	 * \brief How far after a '<' the end of a comment, CDATA
+	 * 	section or other markup has already been searched for.
+	 */
+	size_t markup_scanned;
+};
+
+/**
+ * \brief Initializes a push lexer.
+ *
+ * \returns A push lexer, ready for the start of a script.
+ */
+inline struct descent_xml_lex_push descent_xml_lex_push_init(void)
+{
+	return (struct descent_xml_lex_push) {
+		.type = (descent_xml_classifier_fn*)descent_xml_classifier_start,
+	};
+}
+
+// Whether the markup after a '<' is all in the buffer. The
+// markup handlers can't tell a cut-off section from a broken
+// one, so they only get called once the end is there. scanned
+// is where the search for the end stopped last time: it's
+// carried on from there, and updated if the end still isn't
+// in the buffer, so a long section is only searched once.
+inline bool _descent_xml_lex_push_markup_ready(
+	struct libadt_const_lptr next,
+	size_t *scanned
+)
+{
+	const struct libadt_const_lptr
+		comment = libadt_str_literal("!--"),
+		cdata = libadt_str_literal("![CDATA[");
+	const char *const bytes = next.buffer;
+	const size_t length = (size_t)next.length;
+	size_t from = *scanned;
+	ssize_t end;
+
+	if (bytes[0] != '!' && bytes[0] != '?')
+		return true;
+
+	if (
+		_descent_xml_lex_startswith(next, comment)
+		|| _descent_xml_lex_startswith(next, cdata)
+	) {
+		// Both end at the first "--" or "]]", like the markup
+		// handlers, with a byte after it for the '>'
+		const size_t prefix = (size_t)(
+			bytes[1] == '-' ? comment.length : cdata.length
+		);
+		const char close = bytes[1] == '-' ? '-' : ']';
+		if (from < prefix)
+			from = prefix;
+		end = descent_xml_scan_pair(
+			libadt_const_lptr_index(next, (ssize_t)from),
+			close,
+			close
+		);
+		if (end >= 0 && from + (size_t)end + 2 < length)
+			return true;
+	} else if (bytes[0] == '?') {
+		end = descent_xml_scan_pair(
+			libadt_const_lptr_index(next, (ssize_t)from),
+			'?',
+			'>'
+		);
+		if (end >= 0)
+			return true;
+	} else {
+		if (memchr(bytes + from, '>', length - from))
+			return true;
+		*scanned = length;
+		return false;
+	}
+
+	// Either the end wasn't found, or it was found but runs
+	// up to the end of the buffer. Either way, search again
+	// from it, or from the last byte in case it's the first
+	// half of a terminator.
+	if (end >= 0)
+		from += (size_t)end;
+	else if (length - 1 > from)
+		from = length - 1;
+	*scanned = from;
+	return false;
+}
+
+// Whether a token of this type could carry on past the end of
+// the buffer. If no character keeps the classifier in the same
+// state, like after a '>', the token is already complete.
+inline bool _descent_xml_lex_push_can_grow(descent_xml_classifier_fn *type)
+{
+	const enum descent_xml_classifier_state state
+		= descent_xml_classifier_fn_state(type);
+	if (state == DESCENT_XML_CLASSIFIER_STATE_COUNT)
+		return true;
+	for (int c = 0; c < _DESCENT_XML_CLASSIFIER_CLASS_COUNT; c++)
+		if (_descent_xml_classifier_transitions[state][c] == state)
+			return true;
+	return false;
+}
+
+inline struct descent_xml_lex _descent_xml_lex_push_need_input(
+	struct libadt_const_lptr script,
+	struct libadt_const_lptr next
+)
+{
+	return (struct descent_xml_lex) {
+		.type = descent_xml_lex_need_input,
+		.script = script,
+		.value = next,
+	};
+}
+
+inline struct descent_xml_lex _descent_xml_lex_push_complete(
+	struct descent_xml_lex_push *push,
+	struct descent_xml_lex token
+)
+{
+	*push = (struct descent_xml_lex_push) {
+		.type = token.type,
+		.offset = (size_t)(
+			(const char *)token.value.buffer
+			- (const char *)token.script.buffer
+		),
+		.length = (size_t)token.value.length,
+	};
+	return token;
+}
+
+/**
+ * \brief Returns the next token from a script that may not
+ * 	have fully arrived yet.
+ *
+ * When the buffer ends partway through a token, this returns
+ * a descent_xml_lex_need_input token whose value is the
+ * unfinished part of the buffer. Append more of the script
+ * and call this again: lexing carries on from where it
+ * stopped, rather than from the start of the token.
+ *
+ * Comments, CDATA sections, doctypes and XML declarations
+ * are the exception, and are only lexed once their ends
+ * have arrived.
+ *
+ * Tokens returned are the same as descent_xml_lex_next_raw()
+ * returns for the complete script.
+ *
+ * \param push The push lexer's state, updated in-place.
+ * \param script Everything received so far. This must start
+ * 	at the same place in the script every call, but can be
+ * 	in a different buffer; see descent_xml_lex_push_discard()
+ * 	for dropping the start of it.
+ * \param final Whether the end of script is the end of the
+ * 	whole script. Once this is true, the end of the buffer
+ * 	is treated as the end of the script, the same as
+ * 	descent_xml_lex_next_raw().
+ *
+ * \returns The next token, or a descent_xml_lex_need_input
+ * 	token.
+ */
+inline struct descent_xml_lex descent_xml_lex_push_next(
+	struct descent_xml_lex_push *push,
+	struct libadt_const_lptr script,
+	bool final
+)
+{
+	const struct descent_xml_lex previous = {
+		.type = push->type,
+		.script = script,
+		.value = libadt_const_lptr_truncate(
+			libadt_const_lptr_index(script, (ssize_t)push->offset),
+			push->length
+		),
+	};
+	const struct libadt_const_lptr next = _descent_xml_lex_remainder(previous);
+	_descent_xml_lex_read_t read = { 0 };
+
+	if (!push->pending) {
+		if (!final) {
+			if (next.length <= 0)
+				return _descent_xml_lex_push_need_input(script, next);
+			const bool markup = previous.type == descent_xml_classifier_element
+				&& !_descent_xml_lex_push_markup_ready(next, &push->markup_scanned);
+			if (markup)
+				return _descent_xml_lex_push_need_input(script, next);
+		}
+
+		struct descent_xml_lex test = _descent_xml_lex_next_markup(previous);
+		if (test.type != descent_xml_classifier_unexpected)
+			return _descent_xml_lex_push_complete(push, test);
+
+		read = _descent_xml_lex_read(next, previous.type);
+		if (read.amount == -2 && !final)
+			return _descent_xml_lex_push_need_input(script, next);
+
+		if (_descent_xml_lex_read_error(read))
+			return _descent_xml_lex_push_complete(
+				push,
+				(struct descent_xml_lex) {
+					.type = descent_xml_classifier_unexpected,
+					.script = script,
+					.value = libadt_const_lptr_truncate(next, 0),
+				}
+			);
+
+		if (read.type == descent_xml_classifier_eof)
+			return _descent_xml_lex_push_complete(
+				push,
+				(struct descent_xml_lex) {
+					.type = read.type,
+					.script = script,
+					.value = libadt_const_lptr_truncate(next, (size_t)read.amount),
+				}
+			);
+
+		push->pending = read.type;
+		push->scanned = (size_t)read.amount;
+	}
+
+	for (;;) {
+		struct libadt_const_lptr remainder
+			= libadt_const_lptr_index(next, (ssize_t)push->scanned);
+		const ssize_t skipped = _descent_xml_lex_skip(remainder, push->pending);
+		push->scanned += (size_t)skipped;
+		remainder = libadt_const_lptr_index(remainder, skipped);
+
+		if (remainder.length <= 0 && !final) {
+			if (!_descent_xml_lex_push_can_grow(push->pending))
+				break;
+			return _descent_xml_lex_push_need_input(script, next);
+		}
+
+		read = _descent_xml_lex_read(remainder, push->pending);
+		if (read.amount == -2 && !final)
+			return _descent_xml_lex_push_need_input(script, next);
+		if (_descent_xml_lex_read_error(read))
+			break;
+		if (read.type != push->pending)
+			break;
+
+		push->scanned += (size_t)read.amount;
+	}
+
+	return _descent_xml_lex_push_complete(
+		push,
+		(struct descent_xml_lex) {
+			.type = push->pending,
+			.script = script,
+			.value = libadt_const_lptr_truncate(next, push->scanned),
+		}
+	);
+}
+
+/**
+ * \brief Adjusts a push lexer for the start of its script
+ * 	being dropped.
+ *
+ * Call this after removing bytes from the start of the buffer
+ * passed to descent_xml_lex_push_next(), so the following
+ * script can start after them.
+ *
+ * \param push The push lexer to adjust.
+ * \param amount The number of bytes dropped. This must not be
+ * 	more than push->offset, since the last token is still
+ * 	needed to lex the next one.
+ */
+inline void descent_xml_lex_push_discard(
+	struct descent_xml_lex_push *push,
+	size_t amount
+)
+{
+	push->offset -= amount;
+}
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,94 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DESCENT_XML_PARALLEL
+#define DESCENT_XML_PARALLEL
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lex.h"
+
+/**
+ * \file
+ *
+ * Validating a single document on several threads.
+ *
+ * The script is split into chunks, each starting at a `<`, and
+ * each chunk is lexed on its own thread on the guess that its
+ * `<` starts a tag. Each thread summarizes its chunk: the end
+ * tags it couldn't match, the start tags it left open, and
+ * anything whose validity depends on where in the document it
+ * is. The summaries are then stitched together in order.
+ *
+ * A guess is wrong when a `<` sits inside a comment or CDATA
+ * section that began in an earlier chunk. That's noticed while
+ * stitching, and the affected part of the script is lexed again
+ * from where the earlier chunk really ended.
+ */
+
+/**
+ * \brief The default chunk size, in bytes.
+ */
+#define DESCENT_XML_PARALLEL_CHUNK (1 << 20)
+
+/**
+ * \brief Validates a document on several threads.
+ *
+ * \param token A token from descent_xml_lex_init().
+ * \param depth The maximum number of nested elements, or a
+ * 	negative number for no limit.
+ * \param workers The number of threads to use, including
+ * 	the calling thread.
+ * \param chunk The approximate size of each chunk, in bytes,
+ * 	or 0 for DESCENT_XML_PARALLEL_CHUNK.
+ *
+ * \returns Whether the document is valid. This gives the
+ * 	same result as descent_xml_validate_step() fed every
+ * 	token, and is false if memory runs out.
+ */
+bool descent_xml_parallel_validate_depth(
+	struct descent_xml_lex token,
+	int depth,
+	int workers,
+	size_t chunk
+);
+
+/**
+ * \brief Validates a document on several threads, with a
+ * 	reasonable depth limit and chunk size.
+ *
+ * \param token A token from descent_xml_lex_init().
+ * \param workers The number of threads to use.
+ *
+ * \returns Whether the document is valid.
+ */
+bool descent_xml_parallel_validate(
+	struct descent_xml_lex token,
+	int workers
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // DESCENT_XML_PARALLEL
@@ -28,10 +28,11 @@ extern "C" {
 #include <stdbool.h>
 
 
+#include "arena.h"
+#include "intern.h"
 #include "lex.h"
 
 #include <libadt/lptr.h>
-#include <libadt/vector.h>
 
 /**
  * \file
@@ -176,7 +177,108 @@ inline _descent_xml_value_t _descent_xml_attribute_value(
 	return (_descent_xml_value_t) { result, next };
 }
 
+extern descent_xml_classifier_void_fn *descent_xml_parse_error(wchar_t);
+
+/**
+ * \brief The number of attributes an element can have before
+ * 	their names and values no longer fit in a buffer on the
+ * 	stack.
+ */
+#define DESCENT_XML_PARSE_INLINE_ATTRIBUTES 8
+
+/**
+ * \brief Memory kept between calls to descent_xml_parse_with().
+ *
+ * Each element's attributes are collected in a buffer on the
+ * stack, with room for DESCENT_XML_PARSE_INLINE_ATTRIBUTES of them.
+ * Elements with more than that use memory from a parse context,
+ * which is kept for the next element once the handler returns, so
+ * parsing with a context doesn't allocate once the context has grown
+ * big enough for the document's largest elements.
+ *
+ * Initialize with descent_xml_parse_context_init() and release
+ * with descent_xml_parse_context_free().
+ */
+struct descent_xml_parse_context {
+	// Each element's overflowing attributes are taken from
+	// here, and given back when its handler returns
+	struct descent_xml_arena _arena;
+};
+
+/**
+ * \brief Initializes an empty parse context.
+ *
+ * \returns The context.
+ */
+inline struct descent_xml_parse_context descent_xml_parse_context_init(void)
+{
+	return (struct descent_xml_parse_context) {
+		._arena = descent_xml_arena_init(),
+	};
+}
+
+/**
+ * \brief Releases the memory held by a parse context.
+ *
+ * \param parse The context to release.
+ */
+inline void descent_xml_parse_context_free(
+	struct descent_xml_parse_context *parse
+)
+{
+	descent_xml_arena_free(&parse->_arena);
+}
+
+typedef struct {
+	struct libadt_const_lptr *spans;
+	size_t length;
+	size_t capacity;
+
+	// Where to grow into once the inline spans are full, or
+	// NULL to grow on the heap
+	struct descent_xml_arena *arena;
+
+	struct libadt_const_lptr inline_spans[2 * DESCENT_XML_PARSE_INLINE_ATTRIBUTES];
+} _descent_xml_attribute_spans_t;
+
+inline bool _descent_xml_attribute_spans_append(
+	_descent_xml_attribute_spans_t *attributes,
+	struct libadt_const_lptr span
+)
+{
+	if (attributes->length == attributes->capacity) {
+		const size_t capacity = attributes->capacity * 2;
+		const size_t size = capacity * sizeof(struct libadt_const_lptr);
+		const bool copy = attributes->arena
+			|| attributes->spans == attributes->inline_spans;
+
+		struct libadt_const_lptr *spans;
+		if (attributes->arena)
+			spans = descent_xml_arena_alloc(attributes->arena, size);
+		else if (copy)
+			spans = malloc(size);
+		else
+			spans = realloc(attributes->spans, size);
+		if (!spans)
+			return false;
+
+		if (copy) {
+			memcpy(
+				spans,
+				attributes->spans,
+				attributes->length * sizeof(struct libadt_const_lptr)
+			);
+		}
+		attributes->spans = spans;
+		attributes->capacity = capacity;
+	}
+
+	attributes->spans[attributes->length++] = span;
+	return true;
+}
+
 inline struct descent_xml_lex _descent_xml_handle_element(
+	struct descent_xml_parse_context *parse,
 	struct descent_xml_lex token,
 	descent_xml_parse_element_fn *element_handler,
 	void *context
@@ -188,64 +290,78 @@ inline struct descent_xml_lex _descent_xml_handle_element(
 	if (token.type == descent_xml_classifier_unexpected)
 		return token;
 
-	LIBADT_VECTOR_WITH(attributes, sizeof(struct libadt_const_lptr), 0) {
-		while (token.type == descent_xml_classifier_element_space) {
-			token = descent_xml_lex_next_raw(token);
+	_descent_xml_attribute_spans_t attributes = {
+		.capacity = 2 * DESCENT_XML_PARSE_INLINE_ATTRIBUTES,
+		.arena = parse ? &parse->_arena : NULL,
+	};
+	attributes.spans = attributes.inline_spans;
+	const struct descent_xml_arena_mark mark = parse
+		? descent_xml_arena_mark(&parse->_arena)
+		: (struct descent_xml_arena_mark) { 0 };
+	bool error = false;
+
+	while (token.type == descent_xml_classifier_element_space) {
+		token = descent_xml_lex_next_raw(token);
+
+		if (token.type == descent_xml_classifier_unexpected)
+			break;
 
+		if (token.type == descent_xml_classifier_attribute_name) {
+			if (!_descent_xml_attribute_spans_append(&attributes, token.value)) {
+				error = true;
+				break;
+			}
+			token = descent_xml_lex_next_raw(token);
 			if (token.type == descent_xml_classifier_unexpected)
 				break;
-
-			if (token.type == descent_xml_classifier_attribute_name) {
-				attributes = libadt_vector_append(
-					attributes,
-					&token.value
-				);
+			if (token.type == descent_xml_classifier_attribute_expect_assign)
 				token = descent_xml_lex_next_raw(token);
-				if (token.type == descent_xml_classifier_unexpected)
-					break;
-				if (token.type == descent_xml_classifier_attribute_expect_assign)
-					token = descent_xml_lex_next_raw(token);
-				if (token.type == descent_xml_classifier_attribute_assign)
-					token = descent_xml_lex_next_raw(token);
-				const bool quote =
-					token.type == descent_xml_classifier_attribute_value_single_quote_start
-					|| token.type == descent_xml_classifier_attribute_value_double_quote_start;
-				if (quote)
-					token = descent_xml_lex_next_raw(token);
-
-				_descent_xml_value_t attr
-					= _descent_xml_attribute_value(token);
-				attributes = libadt_vector_append(
-					attributes,
-					&attr.value
-				);
-				token = attr.token;
+			if (token.type == descent_xml_classifier_attribute_assign)
+				token = descent_xml_lex_next_raw(token);
+			const bool quote =
+				token.type == descent_xml_classifier_attribute_value_single_quote_start
+				|| token.type == descent_xml_classifier_attribute_value_double_quote_start;
+			if (quote)
 				token = descent_xml_lex_next_raw(token);
+
+			_descent_xml_value_t attr
+				= _descent_xml_attribute_value(token);
+			if (!_descent_xml_attribute_spans_append(&attributes, attr.value)) {
+				error = true;
+				break;
 			}
+			token = attr.token;
+			if (token.type == descent_xml_classifier_unexpected)
+				break;
+			token = descent_xml_lex_next_raw(token);
 		}
+	}
 
-		if (token.type == descent_xml_classifier_unexpected)
-			continue;
-
-		const bool is_empty
-			= token.type == descent_xml_classifier_element_empty;
+	const bool is_empty
+		= token.type == descent_xml_classifier_element_empty;
 
-		if (is_empty || token.type == descent_xml_classifier_element_end) {
-			struct libadt_const_lptr attribsptr = {
-				.buffer = attributes.buffer,
-				.size = sizeof(struct libadt_const_lptr),
-				.length = (ssize_t)attributes.length,
-			};
+	if (error) {
+		token.type = descent_xml_parse_error;
+	} else if (is_empty || token.type == descent_xml_classifier_element_end) {
+		struct libadt_const_lptr attribsptr = {
+			.buffer = attributes.length ? attributes.spans : NULL,
+			.size = sizeof(struct libadt_const_lptr),
+			.length = (ssize_t)attributes.length,
+		};
 
-			token = element_handler(
-				token,
-				name,
-				attribsptr,
-				is_empty,
-				context
-			);
-		}
+		token = element_handler(
+			token,
+			name,
+			attribsptr,
+			is_empty,
+			context
+		);
 	}
+
+	if (parse)
+		descent_xml_arena_reset(&parse->_arena, mark);
+	else if (attributes.spans != attributes.inline_spans)
+		free(attributes.spans);
 	return token;
 }
 
@@ -282,6 +398,68 @@ inline struct descent_xml_lex _descent_xml_handle_text(
 	return result.token;
 }
 
+/**
+ * \brief Parses an XML entity as descent_xml_parse() does, keeping
+ * 	memory for elements' attributes in a parse context.
+ *
+ * Handlers that parse their element's children should pass the
+ * same context on to their own calls.
+ *
+ * \param parse The context to keep memory in. Passing NULL is
+ * 	the same as calling descent_xml_parse().
+ * \param xml A token into an XML document.
+ * \param element_handler A callback to call when encountering an
+ * 	opening element tag. Pass a NULL pointer to disable.
+ * \param text_handler A callback to call when encountering a
+ * 	text node. Pass a NULL pointer to disable.
+ * \param context A user-provided pointer that will be passed
+ * 	to the callbacks.
+ *
+ * \returns The last token encountered while parsing, as with
+ * 	descent_xml_parse(). If the `type` property is
+ * 	`descent_xml_parse_error`, the memory for an element's
+ * 	attributes couldn't be allocated.
+ */
+inline struct descent_xml_lex descent_xml_parse_with(
+	struct descent_xml_parse_context *parse,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_fn *element_handler,
+	descent_xml_parse_text_fn *text_handler,
+	void *context
+)
+{
+	xml = descent_xml_lex_next_raw(xml);
+
+	if (xml.type == descent_xml_classifier_element_name && element_handler) {
+		xml = _descent_xml_handle_element(
+			parse,
+			xml,
+			element_handler,
+			context
+		);
+	} else if (_descent_xml_is_text_type(xml) && text_handler) {
+		xml = _descent_xml_handle_text(
+			xml,
+			text_handler,
+			context
+		);
+	} else if (xml.type == descent_xml_lex_cdata && text_handler) {
+		// TODO: clean this up
+		struct libadt_const_lptr arg
+			= libadt_const_lptr_index(
+				xml.value,
+				sizeof("![CDATA[") - 1
+			);
+		arg = libadt_const_lptr_truncate(
+			arg,
+			arg.length - 2 /* ]] */
+		);
+		text_handler(arg, true, context);
+	}
+
+	return xml;
+}
+
 /**
  * \brief Function for parsing an XML document.
  *
@@ -315,6 +493,8 @@ inline struct descent_xml_lex _descent_xml_handle_text(
  * 	in an expected way.
  *
  * \sa descent_xml_parse_cstr() An interface for C-style strings.
+ * \sa descent_xml_parse_with() A version that reuses memory for
+ * 	elements with many attributes.
  */
 inline struct descent_xml_lex descent_xml_parse(
 	struct descent_xml_lex xml,
@@ -323,45 +503,580 @@ inline struct descent_xml_lex descent_xml_parse(
 	void *context
 )
 {
-	xml = descent_xml_lex_next_raw(xml);
+	return descent_xml_parse_with(
+		NULL,
+		xml,
+		element_handler,
+		text_handler,
+		context
+	);
+}
 
-	if (xml.type == descent_xml_classifier_element_name && element_handler) {
-		xml = _descent_xml_handle_element(
-			xml,
-			element_handler,
-			context
+/**
+ * \brief The ID descent_xml_parse_events() gives names that
+ * 	aren't in the handlers' names table, once the table has
+ * 	reached its names_limit.
+ */
+#define DESCENT_XML_PARSE_UNKNOWN_NAME ((ssize_t)-2)
+
+/**
+ * \brief The most names descent_xml_parse_events() adds to the
+ * 	handlers' names table when names_limit is 0.
+ */
+#define DESCENT_XML_PARSE_NAMES_LIMIT 1024
+
+/**
+ * \brief An element passed to the callbacks of
+ * 	descent_xml_parse_events().
+ */
+struct descent_xml_parse_element {
+	/**
+	 * \brief The element's name.
+	 */
+	struct libadt_const_lptr name;
+
+	/**
+	 * \brief The element's attributes, as passed to a
+	 * 	descent_xml_parse_element_fn: names and values,
+	 * 	one after the other. Empty for closing tags.
+	 */
+	struct libadt_const_lptr attributes;
+
+	/**
+	 * \brief True if the element is an empty element, of
+	 * 	the format `<element-name />`.
+	 */
+	bool empty;
+
+	/**
+	 * \brief The ID of name in the handlers' names table,
+	 * 	or -1 if there isn't one. Names the table is too
+	 * 	full to add are DESCENT_XML_PARSE_UNKNOWN_NAME.
+	 */
+	ssize_t id;
+
+	/**
+	 * \brief The ID of each attribute's name in the
+	 * 	handlers' names table, in order. There is one ID
+	 * 	for every two elements of attributes. This can be
+	 * 	NULL if there are no attributes, and is always
+	 * 	NULL if there's no table.
+	 */
+	const ssize_t *attribute_ids;
+};
+
+/**
+ * \brief Type signature for the start and end element callbacks
+ * 	of descent_xml_parse_events().
+ *
+ * \param element The element being started or ended.
+ * \param context The context from the handlers.
+ *
+ * \returns true to continue parsing, or false to stop.
+ */
+typedef bool descent_xml_parse_event_element_fn(
+	const struct descent_xml_parse_element *element,
+	void *context
+);
+
+/**
+ * \brief Type signature for the text callback of
+ * 	descent_xml_parse_events().
+ *
+ * \param text The text, or the contents of a CDATA section.
+ * \param is_cdata True if text came from a CDATA section.
+ * \param context The context from the handlers.
+ *
+ * \returns true to continue parsing, or false to stop.
+ */
+typedef bool descent_xml_parse_event_text_fn(
+	struct libadt_const_lptr text,
+	bool is_cdata,
+	void *context
+);
+
+/**
+ * \brief The kinds of segment in a text node passed to a
+ * 	descent_xml_parse_event_segments_fn.
+ */
+enum descent_xml_parse_segment_type {
+	/**
+	 * \brief Character data, including whitespace.
+	 */
+	DESCENT_XML_PARSE_SEGMENT_TEXT,
+
+	/**
+	 * \brief An entity or character reference, from the `&`
+	 * 	to the `;`. See descent_xml_entity_decode().
+	 */
+	DESCENT_XML_PARSE_SEGMENT_ENTITY,
+
+	/**
+	 * \brief The contents of a CDATA section.
+	 */
+	DESCENT_XML_PARSE_SEGMENT_CDATA,
+};
+
+/**
+ * \brief A piece of a text node.
+ */
+struct descent_xml_parse_segment {
+	/**
+	 * \brief The segment's bytes, pointing into the script.
+	 */
+	struct libadt_const_lptr value;
+
+	/**
+	 * \brief What the bytes are.
+	 */
+	enum descent_xml_parse_segment_type type;
+};
+
+/**
+ * \brief Type signature for the segments callback of
+ * 	descent_xml_parse_events().
+ *
+ * \param segments An libadt_const_lptr of struct
+ * 	descent_xml_parse_segment, in document order.
+ * 	segments.length contains the number of segments. Adjacent
+ * 	text is always a single segment.
+ * \param context The context from the handlers.
+ *
+ * \returns true to continue parsing, or false to stop.
+ */
+typedef bool descent_xml_parse_event_segments_fn(
+	struct libadt_const_lptr segments,
+	void *context
+);
+
+/**
+ * \brief The callbacks for descent_xml_parse_events().
+ *
+ * Any of the callbacks can be NULL, to ignore those events.
+ */
+struct descent_xml_parse_handlers {
+	/**
+	 * \brief Called for each start tag and empty element.
+	 */
+	descent_xml_parse_event_element_fn *start;
+
+	/**
+	 * \brief Called for each closing tag, and after start
+	 * 	for each empty element.
+	 */
+	descent_xml_parse_event_element_fn *end;
+
+	/**
+	 * \brief Called for each text node and CDATA section.
+	 */
+	descent_xml_parse_event_text_fn *text;
+
+	/**
+	 * \brief A user-provided pointer that will be passed
+	 * 	to the callbacks.
+	 */
+	void *context;
+
+	/**
+	 * \brief A table to look up element and attribute names
+	 * 	in, or NULL. Names that aren't in the table are
+	 * 	added to it, up to names_limit.
+	 */
+	struct descent_xml_intern *names;
+
+	/**
+	 * \brief The most names to let names grow to, or 0 for
+	 * 	DESCENT_XML_PARSE_NAMES_LIMIT. Once the table is full,
+	 * 	names that aren't in it get the ID
+	 * 	DESCENT_XML_PARSE_UNKNOWN_NAME, so a document can't
+	 * 	grow it without bound. Set this to names->count to
+	 * 	only look names up, or to SIZE_MAX to add every name.
+	 */
+	size_t names_limit;
+
+	/**
+	 * \brief Called once for each run of text, references and
+	 * 	CDATA sections between two pieces of markup, with
+	 * 	the run split into segments. If this is set, text
+	 * 	isn't called.
+	 */
+	descent_xml_parse_event_segments_fn *segments;
+};
+
+typedef struct {
+	const struct descent_xml_parse_handlers *const handlers;
+	bool stop;
+	bool error;
+
+	// reused for each element's attribute IDs
+	ssize_t *attribute_ids;
+	size_t attribute_ids_capacity;
+
+	// reused for each text node's segments
+	struct descent_xml_parse_segment *segments;
+	size_t segments_length;
+	size_t segments_capacity;
+} _descent_xml_parse_events_context;
+
+inline bool _descent_xml_parse_events_append(
+	_descent_xml_parse_events_context *events,
+	struct libadt_const_lptr value,
+	enum descent_xml_parse_segment_type type
+)
+{
+	if (events->segments_length == events->segments_capacity) {
+		const size_t capacity = events->segments_capacity
+			? events->segments_capacity * 2
+			: 8;
+		struct descent_xml_parse_segment *const segments = realloc(
+			events->segments,
+			capacity * sizeof(*segments)
 		);
-	} else if (_descent_xml_is_text_type(xml) && text_handler) {
-		xml = _descent_xml_handle_text(
-			xml,
-			text_handler,
-			context
+		if (!segments)
+			return false;
+		events->segments = segments;
+		events->segments_capacity = capacity;
+	}
+
+	events->segments[events->segments_length++]
+		= (struct descent_xml_parse_segment) { value, type };
+	return true;
+}
+
+// Adds a text or CDATA token to the current text node, joining
+// it onto the last segment where they're the same kind
+inline bool _descent_xml_parse_events_segment(
+	_descent_xml_parse_events_context *events,
+	struct descent_xml_lex token
+)
+{
+	struct libadt_const_lptr value = token.value;
+	struct descent_xml_parse_segment *const last = events->segments_length
+		? &events->segments[events->segments_length - 1]
+		: NULL;
+
+	if (token.type == descent_xml_lex_cdata) {
+		value = libadt_const_lptr_index(value, sizeof("![CDATA[") - 1);
+		value = libadt_const_lptr_truncate(value, value.length - 2 /* ]] */);
+		return _descent_xml_parse_events_append(
+			events,
+			value,
+			DESCENT_XML_PARSE_SEGMENT_CDATA
 		);
-	} else if (xml.type == descent_xml_lex_cdata && text_handler) {
-		// TODO: clean this up
-		struct libadt_const_lptr arg
-			= libadt_const_lptr_index(
-				xml.value,
-				sizeof("![CDATA[") - 1
-			);
-		arg = libadt_const_lptr_truncate(
-			arg,
-			arg.length - 2 /* ]] */
+	}
+
+	if (token.type == descent_xml_classifier_text_entity_start) {
+		return _descent_xml_parse_events_append(
+			events,
+			value,
+			DESCENT_XML_PARSE_SEGMENT_ENTITY
 		);
-		text_handler(arg, true, context);
 	}
 
-	return xml;
+	if (token.type == descent_xml_classifier_text_entity) {
+		if (last && last->type == DESCENT_XML_PARSE_SEGMENT_ENTITY)
+			last->value.length += value.length;
+		return true;
+	}
+
+	// the lexer leaves a reference's `;` at the start of the
+	// text after it
+	if (last && last->type == DESCENT_XML_PARSE_SEGMENT_ENTITY
+		&& value.length > 0 && *(const char *)value.buffer == ';'
+		&& ((const char *)last->value.buffer)[last->value.length - 1] != ';') {
+		last->value.length++;
+		value = libadt_const_lptr_index(value, 1);
+		if (value.length == 0)
+			return true;
+	}
+
+	if (last && last->type == DESCENT_XML_PARSE_SEGMENT_TEXT
+		&& (const char *)last->value.buffer + last->value.length
+			== (const char *)value.buffer) {
+		last->value.length += value.length;
+		return true;
+	}
+
+	return _descent_xml_parse_events_append(
+		events,
+		value,
+		DESCENT_XML_PARSE_SEGMENT_TEXT
+	);
+}
+
+// Looks up or adds a name, keeping to the table's limit.
+// Returns false if the table couldn't grow.
+inline bool _descent_xml_parse_events_id(
+	const struct descent_xml_parse_handlers *handlers,
+	struct libadt_const_lptr name,
+	ssize_t *id
+)
+{
+	struct descent_xml_intern *const names = handlers->names;
+	const size_t limit = handlers->names_limit
+		? handlers->names_limit
+		: DESCENT_XML_PARSE_NAMES_LIMIT;
+	if (names->count < limit) {
+		*id = descent_xml_intern_add(names, name);
+		return *id >= 0;
+	}
+
+	*id = descent_xml_intern_find(names, name);
+	if (*id < 0)
+		*id = DESCENT_XML_PARSE_UNKNOWN_NAME;
+	return true;
+}
+
+// Fills in the IDs of an element's names, if there's a table
+inline bool _descent_xml_parse_events_intern(
+	_descent_xml_parse_events_context *events,
+	struct descent_xml_parse_element *element
+)
+{
+	struct descent_xml_intern *const names = events->handlers->names;
+	element->id = -1;
+	element->attribute_ids = NULL;
+	if (!names)
+		return true;
+
+	if (!_descent_xml_parse_events_id(events->handlers, element->name, &element->id))
+		return false;
+
+	const size_t count = (size_t)element->attributes.length / 2;
+	if (count > events->attribute_ids_capacity) {
+		size_t capacity = events->attribute_ids_capacity
+			? events->attribute_ids_capacity * 2
+			: 8;
+		while (capacity < count)
+			capacity *= 2;
+		ssize_t *const ids = realloc(
+			events->attribute_ids,
+			capacity * sizeof(*ids)
+		);
+		if (!ids)
+			return false;
+		events->attribute_ids = ids;
+		events->attribute_ids_capacity = capacity;
+	}
+
+	const struct libadt_const_lptr *const attributes
+		= element->attributes.buffer;
+	for (size_t i = 0; i < count; i++) {
+		const bool added = _descent_xml_parse_events_id(
+			events->handlers,
+			attributes[i * 2],
+			&events->attribute_ids[i]
+		);
+		if (!added)
+			return false;
+	}
+	element->attribute_ids = events->attribute_ids;
+	return true;
+}
+
+inline struct descent_xml_lex _descent_xml_parse_events_start(
+	struct descent_xml_lex token,
+	struct libadt_const_lptr element_name,
+	struct libadt_const_lptr attributes,
+	bool empty,
+	void *context
+)
+{
+	_descent_xml_parse_events_context *const events = context;
+	const struct descent_xml_parse_handlers *const handlers = events->handlers;
+	struct descent_xml_parse_element element = {
+		.name = element_name,
+		.attributes = attributes,
+		.empty = empty,
+	};
+
+	if (!_descent_xml_parse_events_intern(events, &element)) {
+		events->error = true;
+		events->stop = true;
+		return token;
+	}
+
+	if (handlers->start && !handlers->start(&element, handlers->context))
+		events->stop = true;
+	// The token returned is past the end of an empty element,
+	// so its end is called even if start stopped, or it would
+	// never be
+	if (empty && handlers->end && !handlers->end(&element, handlers->context))
+		events->stop = true;
+	return token;
+}
+
+/**
+ * \brief Parses a whole XML document, calling a handler for
+ * 	each start tag, end tag and text node.
+ *
+ * Unlike descent_xml_parse(), this loops over the document
+ * itself, and reports closing tags, so handlers don't need to
+ * call back into the parser to find where an element ends.
+ * This lets deeply nested documents be processed by a flat
+ * state machine, without recursion.
+ *
+ * Like descent_xml_parse(), nothing is copied: names,
+ * attributes and text point into the script, and entities
+ * aren't converted. The nesting of elements isn't checked,
+ * so the end callback gets the name from the closing tag;
+ * use descent_xml_validate_document() first to reject
+ * documents where they don't match.
+ *
+ * The text callback gets each CDATA section separately from the
+ * text around it. To get the whole run in one call instead, set
+ * handlers->segments, which is passed the run as a list of text,
+ * reference and CDATA segments, still without copying.
+ *
+ * \param xml A token into an XML document. Can be created on a
+ * 	full XML document using descent_xml_lex_init().
+ * \param handlers The callbacks to call.
+ *
+ * If handlers->names is set, each element's name and its
+ * attributes' names are looked up in it, and their IDs are
+ * passed to the callbacks along with them. Names that aren't
+ * in the table are added, but only until it holds
+ * handlers->names_limit names, which is
+ * DESCENT_XML_PARSE_NAMES_LIMIT unless it's set, so an untrusted
+ * document can't make the table grow without bound. After that,
+ * new names get the ID DESCENT_XML_PARSE_UNKNOWN_NAME.
+ *
+ * \returns The last token processed: a
+ * 	`descent_xml_classifier_eof` token at the end of the
+ * 	document, a `descent_xml_classifier_unexpected` token if
+ * 	there was an error, a `descent_xml_parse_error` token if
+ * 	the names table or the segment list couldn't grow, or, if a
+ * 	callback returned false, the last token of the event it
+ * 	was called for. In that case, the token can be passed
+ * 	back in to carry on. An empty element's start and end
+ * 	are one event: if start returns false, end is still
+ * 	called before stopping, so every start gets its end.
+ */
+inline struct descent_xml_lex descent_xml_parse_events(
+	struct descent_xml_lex xml,
+	const struct descent_xml_parse_handlers *handlers
+)
+{
+	_descent_xml_parse_events_context events = {
+		.handlers = handlers,
+	};
+	struct descent_xml_parse_context parse = descent_xml_parse_context_init();
+	struct descent_xml_lex next = descent_xml_lex_next_raw(xml);
+
+	while (!_descent_xml_end_token(next)) {
+		xml = next;
+
+		if (xml.type == descent_xml_classifier_element_name) {
+			xml = _descent_xml_handle_element(
+				&parse,
+				xml,
+				_descent_xml_parse_events_start,
+				&events
+			);
+			if (xml.type == descent_xml_parse_error) {
+				events.error = events.stop = true;
+				break;
+			}
+			if (_descent_xml_end_token(xml)) {
+				next = xml;
+				break;
+			}
+			next = descent_xml_lex_next_raw(xml);
+		} else if (xml.type == descent_xml_classifier_element_close_name) {
+			struct descent_xml_parse_element element = {
+				.name = xml.value,
+				.attributes = {
+					.size = sizeof(struct libadt_const_lptr),
+				},
+			};
+			if (!_descent_xml_parse_events_intern(&events, &element))
+				events.error = events.stop = true;
+			else if (handlers->end)
+				events.stop = !handlers->end(&element, handlers->context);
+			next = descent_xml_lex_next_raw(xml);
+		} else if (handlers->segments && (_descent_xml_is_text_type(xml)
+			|| xml.type == descent_xml_lex_cdata)) {
+			events.segments_length = 0;
+			for (;;) {
+				if (!_descent_xml_parse_events_segment(&events, xml)) {
+					events.error = events.stop = true;
+					break;
+				}
+				// CDATA sections are lexed between a `<` and a
+				// `>`, which the main loop would skip anyway
+				next = descent_xml_lex_next_raw(xml);
+				if (xml.type == descent_xml_lex_cdata
+					&& next.type == descent_xml_classifier_element_end)
+					next = descent_xml_lex_next_raw(next);
+				if (next.type == descent_xml_classifier_element)
+					next = descent_xml_lex_next_raw(next);
+				if (!_descent_xml_is_text_type(next)
+					&& next.type != descent_xml_lex_cdata)
+					break;
+				xml = next;
+			}
+			if (!events.error) {
+				const struct libadt_const_lptr segments = {
+					.buffer = events.segments,
+					.size = sizeof(struct descent_xml_parse_segment),
+					.length = (ssize_t)events.segments_length,
+				};
+				events.stop = !handlers->segments(segments, handlers->context);
+			}
+		} else if (_descent_xml_is_text_type(xml)) {
+			// the token after the text is kept, instead of
+			// being lexed again on the next time round
+			struct libadt_const_lptr text = xml.value;
+			next = descent_xml_lex_next_raw(xml);
+			while (_descent_xml_is_text_type(next)) {
+				text.length += next.value.length;
+				xml = next;
+				next = descent_xml_lex_next_raw(next);
+			}
+			if (handlers->text)
+				events.stop = !handlers->text(text, false, handlers->context);
+		} else if (xml.type == descent_xml_lex_cdata) {
+			struct libadt_const_lptr text
+				= libadt_const_lptr_index(
+					xml.value,
+					sizeof("![CDATA[") - 1
+				);
+			text = libadt_const_lptr_truncate(
+				text,
+				text.length - 2 /* ]] */
+			);
+			if (handlers->text)
+				events.stop = !handlers->text(text, true, handlers->context);
+			next = descent_xml_lex_next_raw(xml);
+		} else {
+			next = descent_xml_lex_next_raw(xml);
+		}
+
+		if (events.stop)
+			break;
+	}
+
+	free(events.attribute_ids);
+	free(events.segments);
+	descent_xml_parse_context_free(&parse);
+	if (events.error)
+		xml.type = descent_xml_parse_error;
+	return events.stop ? xml : next;
 }
 
 typedef struct {
+	// Where values are copied to, and attributes collected
+	struct descent_xml_parse_context *const parse;
 	descent_xml_parse_element_cstr_fn *const element_handler;
 	descent_xml_parse_text_cstr_fn *const text_handler;
 	void *const context;
 	int error;
 } _descent_xml_parse_cstr_context;
 
-extern descent_xml_classifier_void_fn *descent_xml_parse_error(wchar_t);
+// The context descent_xml_parse_cstr() parses with when it isn't
+// given one. Its arena also holds the copies of values, which are
+// given back when each callback returns, so the chunks are reused.
+extern _Thread_local struct descent_xml_parse_context _descent_xml_parse_cstr_buffers;
 
 inline struct descent_xml_lex _cstr_element_handler(
 	struct descent_xml_lex xml,
@@ -376,21 +1091,27 @@ inline struct descent_xml_lex _cstr_element_handler(
 	if (!cstr_context->element_handler)
 		return xml;
 
-	char *const cname = strndup(element_name.buffer, (size_t)element_name.length);
-	if (!cname)
-		goto error_return_xml;
+	struct descent_xml_arena *const arena = &cstr_context->parse->_arena;
+	const struct descent_xml_arena_mark mark = descent_xml_arena_mark(arena);
 
-	char * *const cattr = calloc((size_t)(attributes.length + 1), sizeof(char*));
+	char * *const cattr = descent_xml_arena_alloc(
+		arena,
+		(size_t)(attributes.length + 1) * sizeof(char*)
+	);
 	if (!cattr)
-		goto error_free_cname;
+		goto error_reset;
+
+	char *const cname = descent_xml_arena_strndup(arena, element_name);
+	if (!cname)
+		goto error_reset;
 
 	for (ssize_t i = 0; i < attributes.length; ++i) {
 		const struct libadt_const_lptr *const attarr = attributes.buffer;
-		const struct libadt_const_lptr *const attribute = &attarr[i];
-		cattr[i] = strndup(attribute->buffer, (size_t)attribute->length);
+		cattr[i] = descent_xml_arena_strndup(arena, attarr[i]);
 		if (!cattr[i])
-			goto error_free_cattr;
+			goto error_reset;
 	}
+	cattr[attributes.length] = NULL;
 
 	xml = cstr_context->element_handler(
 		xml,
@@ -400,22 +1121,11 @@ inline struct descent_xml_lex _cstr_element_handler(
 		cstr_context->context
 	);
 
-	for (char **attr = cattr; *attr; attr++) {
-		free(*attr);
-	}
-	free(cattr);
-	free(cname);
-
+	descent_xml_arena_reset(arena, mark);
 	return xml;
 
-error_free_cattr:
-	for (char **attr = cattr; *attr; attr++) {
-		free(*attr);
-	}
-	free(cattr);
-error_free_cname:
-	free(cname);
-error_return_xml:
+error_reset:
+	descent_xml_arena_reset(arena, mark);
 	xml.type = descent_xml_parse_error;
 	return xml;
 }
@@ -430,7 +1140,10 @@ inline void _cstr_text_handler(
 	if (!cstr_context->text_handler)
 		return;
 
-	char *const ctext = strndup(text.buffer, (size_t)text.length);
+	struct descent_xml_arena *const arena = &cstr_context->parse->_arena;
+	const struct descent_xml_arena_mark mark = descent_xml_arena_mark(arena);
+
+	char *const ctext = descent_xml_arena_strndup(arena, text);
 	if (!ctext) {
 		cstr_context->error = 1;
 		return;
@@ -442,16 +1155,70 @@ inline void _cstr_text_handler(
 		cstr_context->context
 	);
 
-	free(ctext);
+	descent_xml_arena_reset(arena, mark);
+}
+
+/**
+ * \brief Parses an XML entity as descent_xml_parse_cstr() does,
+ * 	copying values into memory from a parse context.
+ *
+ * This lets the caller decide how long the memory for the copies
+ * is kept, for example freeing it once a worker thread is done
+ * with a document, rather than leaving it to the calling thread.
+ * Handlers that parse their element's children should pass the
+ * same context on to their own calls.
+ *
+ * \param parse The context to copy values into. Passing NULL is
+ * 	the same as calling descent_xml_parse_cstr().
+ * \param xml A token into an XML document.
+ * \param element_handler A callback to call when encountering an opening
+ * 	element tag. Pass a NULL pointer to disable.
+ * \param text_handler A callback to call when encountering a text node.
+ * 	Pass a NULL pointer to disable.
+ * \param context A user-provided void pointer that will be passed to
+ * 	the callbacks.
+ *
+ * \returns The last token encountered while parsing, as with
+ * 	descent_xml_parse_cstr().
+ */
+inline struct descent_xml_lex descent_xml_parse_cstr_with(
+	struct descent_xml_parse_context *parse,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_cstr_fn *element_handler,
+	descent_xml_parse_text_cstr_fn *text_handler,
+	void *context
+)
+{
+	_descent_xml_parse_cstr_context cstr_context = {
+		.parse = parse ? parse : &_descent_xml_parse_cstr_buffers,
+		.element_handler = element_handler,
+		.text_handler = text_handler,
+		.context = context,
+	};
+	xml = descent_xml_parse_with(
+		cstr_context.parse,
+		xml,
+		_cstr_element_handler,
+		_cstr_text_handler,
+		&cstr_context
+	);
+	if (cstr_context.error)
+		xml.type = descent_xml_parse_error;
+	return xml;
 }
 
 /**
  * \brief Function for parsing an XML document.
  *
- * descent_xml_parse_cstr() is the version of the parser that allocates
- * memory to copy values into. The strings are null-terminated
- * char arrays, and are freed by the parser after the relevant callback
- * is finished running.
+ * descent_xml_parse_cstr() is the version of the parser that copies
+ * values into null-terminated char arrays. The strings are only valid
+ * until the relevant callback is finished running.
+ *
+ * The copies are made in memory that each thread keeps between calls,
+ * so once it has grown big enough for a document's largest values,
+ * parsing doesn't allocate. Call descent_xml_parse_cstr_release() to
+ * free it, or use descent_xml_parse_cstr_with() to keep the memory in
+ * a context of your own.
  *
  * Entities are not converted.
  *
@@ -488,16 +1255,235 @@ inline struct descent_xml_lex descent_xml_parse_cstr(
 	void *context
 )
 {
-	_descent_xml_parse_cstr_context cstr_context = {
-		.element_handler = element_handler,
-		.text_handler = text_handler,
-		.context = context,
+	return descent_xml_parse_cstr_with(
+		NULL,
+		xml,
+		element_handler,
+		text_handler,
+		context
+	);
+}
+
+/**
+ * \brief Frees the memory descent_xml_parse_cstr() and
+ * 	descent_xml_parse_insitu() keep on the calling thread.
+ *
+ * Call this when a thread is done parsing. It mustn't be called
+ * from inside one of their callbacks.
+ */
+inline void descent_xml_parse_cstr_release(void)
+{
+	descent_xml_parse_context_free(&_descent_xml_parse_cstr_buffers);
+}
+
+typedef struct {
+	_descent_xml_parse_cstr_context cstr;
+
+	// The end of the script. Text can run up to it, leaving
+	// nowhere to write a terminator.
+	const char *end;
+} _descent_xml_parse_insitu_context;
+
+// Writes a null byte after span, returning the span as a string
+// and the byte it replaced through saved
+inline char *_descent_xml_insitu_terminate(
+	struct libadt_const_lptr span,
+	char *saved
+)
+{
+	char *const string = (char *)span.buffer;
+	*saved = string[span.length];
+	string[span.length] = '\0';
+	return string;
+}
+
+inline void _descent_xml_insitu_restore(
+	struct libadt_const_lptr span,
+	char saved
+)
+{
+	((char *)span.buffer)[span.length] = saved;
+}
+
+inline struct descent_xml_lex _insitu_element_handler(
+	struct descent_xml_lex xml,
+	struct libadt_const_lptr element_name,
+	struct libadt_const_lptr attributes,
+	bool empty,
+	void *context
+)
+{
+	const _descent_xml_parse_insitu_context *const insitu_context = context;
+	const _descent_xml_parse_cstr_context *const cstr_context
+		= &insitu_context->cstr;
+	if (!cstr_context->element_handler)
+		return xml;
+
+	struct descent_xml_arena *const arena = &cstr_context->parse->_arena;
+	const struct descent_xml_arena_mark mark = descent_xml_arena_mark(arena);
+
+	const size_t count = (size_t)attributes.length;
+	char * *const cattr = descent_xml_arena_alloc(
+		arena,
+		(count + 1) * sizeof(char*)
+	);
+	char *const saved = descent_xml_arena_alloc(arena, count + 1);
+	if (!cattr || !saved) {
+		descent_xml_arena_reset(arena, mark);
+		xml.type = descent_xml_parse_error;
+		return xml;
+	}
+
+	// An attribute without a value ends where its name does, so
+	// the bytes are put back in the reverse order they were saved
+	const struct libadt_const_lptr *const attarr = attributes.buffer;
+	char *const cname = _descent_xml_insitu_terminate(element_name, &saved[count]);
+	for (size_t i = 0; i < count; ++i)
+		cattr[i] = _descent_xml_insitu_terminate(attarr[i], &saved[i]);
+	cattr[count] = NULL;
+
+	xml = cstr_context->element_handler(
+		xml,
+		cname,
+		cattr,
+		empty,
+		cstr_context->context
+	);
+
+	for (size_t i = count; i-- > 0;)
+		_descent_xml_insitu_restore(attarr[i], saved[i]);
+	_descent_xml_insitu_restore(element_name, saved[count]);
+
+	descent_xml_arena_reset(arena, mark);
+	return xml;
+}
+
+inline void _insitu_text_handler(
+	struct libadt_const_lptr text,
+	bool is_cdata,
+	void *context
+)
+{
+	_descent_xml_parse_insitu_context *const insitu_context = context;
+	_descent_xml_parse_cstr_context *const cstr_context
+		= &insitu_context->cstr;
+	if (!cstr_context->text_handler)
+		return;
+
+	const char *const end = (const char *)text.buffer + text.length;
+	if (end == insitu_context->end) {
+		_cstr_text_handler(text, is_cdata, cstr_context);
+		return;
+	}
+
+	char saved;
+	char *const ctext = _descent_xml_insitu_terminate(text, &saved);
+	cstr_context->text_handler(
+		ctext,
+		is_cdata,
+		cstr_context->context
+	);
+	_descent_xml_insitu_restore(text, saved);
+}
+
+/**
+ * \brief Parses an XML entity in a writable buffer as
+ * 	descent_xml_parse_insitu() does, keeping memory in a parse
+ * 	context.
+ *
+ * See descent_xml_parse_cstr_with() for why.
+ *
+ * \param parse The context to keep memory in. Passing NULL is
+ * 	the same as calling descent_xml_parse_insitu().
+ * \param xml A token into an XML document that can be written to.
+ * \param element_handler A callback to call when encountering an opening
+ * 	element tag. Pass a NULL pointer to disable.
+ * \param text_handler A callback to call when encountering a text node.
+ * 	Pass a NULL pointer to disable.
+ * \param context A user-provided void pointer that will be passed to
+ * 	the callbacks.
+ *
+ * \returns The last token encountered while parsing, as with
+ * 	descent_xml_parse_cstr().
+ */
+inline struct descent_xml_lex descent_xml_parse_insitu_with(
+	struct descent_xml_parse_context *parse,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_cstr_fn *element_handler,
+	descent_xml_parse_text_cstr_fn *text_handler,
+	void *context
+)
+{
+	_descent_xml_parse_insitu_context insitu_context = {
+		.cstr = {
+			.parse = parse ? parse : &_descent_xml_parse_cstr_buffers,
+			.element_handler = element_handler,
+			.text_handler = text_handler,
+			.context = context,
+		},
+		.end = (const char *)xml.script.buffer + xml.script.length,
 	};
-	return descent_xml_parse(
+	xml = descent_xml_parse_with(
+		insitu_context.cstr.parse,
 		xml,
-		_cstr_element_handler,
-		_cstr_text_handler,
-		&cstr_context
+		_insitu_element_handler,
+		_insitu_text_handler,
+		&insitu_context
+	);
+	if (insitu_context.cstr.error)
+		xml.type = descent_xml_parse_error;
+	return xml;
+}
+
+/**
+ * \brief Function for parsing an XML document in a writable buffer.
+ *
+ * descent_xml_parse_insitu() passes the same null-terminated strings
+ * to its callbacks as descent_xml_parse_cstr(), but instead of copying
+ * each value, it writes a null byte into the document just after the
+ * value and passes a pointer into the document. The bytes it overwrites
+ * have already been read by the lexer, and are put back when the
+ * callback returns, so the document is unchanged afterwards.
+ *
+ * Text that runs to the very end of the document has no byte after it
+ * to overwrite, so it's copied instead, as descent_xml_parse_cstr()
+ * does.
+ *
+ * The strings are only valid until the relevant callback is finished
+ * running, and mustn't be written to.
+ *
+ * \param xml A token into an XML document that can be written to, like
+ * 	one created with descent_xml_lex_init() on a char array the
+ * 	caller owns. Parsing a document in read-only memory, like a
+ * 	string literal, is undefined behaviour.
+ * \param element_handler A callback to call when encountering an opening
+ * 	element tag. Pass a NULL pointer to disable.
+ * \param text_handler A callback to call when encountering a text node.
+ * 	Pass a NULL pointer to disable.
+ * \param context A user-provided void pointer that will be passed to
+ * 	the callbacks.
+ *
+ * \returns The last token encountered while parsing, as with
+ * 	descent_xml_parse_cstr().
+ *
+ * \sa descent_xml_parse_cstr() A version that doesn't write to the
+ * 	document.
+ * \sa descent_xml_parse_insitu_with() A version that keeps memory in
+ * 	a context of the caller's.
+ */
+inline struct descent_xml_lex descent_xml_parse_insitu(
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_cstr_fn *element_handler,
+	descent_xml_parse_text_cstr_fn *text_handler,
+	void *context
+)
+{
+	return descent_xml_parse_insitu_with(
+		NULL,
+		xml,
+		element_handler,
+		text_handler,
+		context
 	);
 }
 
@@ -0,0 +1,107 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DESCENT_XML_SCAN
+#define DESCENT_XML_SCAN
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <libadt/lptr.h>
+
+/**
+ * \file
+ *
+ * Byte-level scanning functions, used by the lexer to skip
+ * over runs of characters that can't change its state.
+ *
+ * These only look at bytes, so they stop at anything that
+ * isn't plain ASCII and leave multibyte characters to the
+ * character decoder.
+ *
+ * If the library was compiled with SSE2 or AVX2 enabled
+ * (e.g. with `-msse2` or `-mavx2`), these functions check
+ * 16 or 32 bytes at a time. Otherwise, they fall back to
+ * checking each byte.
+ */
+
+/**
+ * \brief Counts the bytes at the start of string that
+ * 	can't end a text node.
+ *
+ * \param string The string to scan.
+ *
+ * \returns The number of bytes before the first `<`,
+ * 	`&`, `%`, null byte or non-ASCII byte, or
+ * 	string.length if there are none.
+ */
+ssize_t descent_xml_scan_text(struct libadt_const_lptr string);
+
+/**
+ * \brief Counts the bytes at the start of string that
+ * 	can't end a quoted attribute value.
+ *
+ * \param string The string to scan, starting inside
+ * 	the quotes.
+ * \param quote The quote character the value was
+ * 	opened with, either `'` or `"`.
+ *
+ * \returns The number of bytes before the first closing
+ * 	quote, `<`, `&`, `%`, null byte or non-ASCII byte,
+ * 	or string.length if there are none.
+ */
+ssize_t descent_xml_scan_attribute_value(
+	struct libadt_const_lptr string,
+	char quote
+);
+
+/**
+ * \brief Counts the whitespace bytes at the start of string.
+ *
+ * \param string The string to scan.
+ *
+ * \returns The number of leading space, tab, carriage
+ * 	return and newline bytes.
+ */
+ssize_t descent_xml_scan_space(struct libadt_const_lptr string);
+
+/**
+ * \brief Finds the first occurrence of a two-byte sequence.
+ *
+ * Used for finding the ends of sections that can contain
+ * anything but their terminator, like comments and CDATA.
+ *
+ * \param string The string to search.
+ * \param first The first byte of the sequence.
+ * \param second The second byte of the sequence.
+ *
+ * \returns The index of first in the first occurrence of the
+ * 	sequence, or -1 if string doesn't contain it.
+ */
+ssize_t descent_xml_scan_pair(
+	struct libadt_const_lptr string,
+	char first,
+	char second
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // DESCENT_XML_SCAN
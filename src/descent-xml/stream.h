@@ -0,0 +1,157 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DESCENT_XML_STREAM
+#define DESCENT_XML_STREAM
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lex.h"
+#include "validate.h"
+
+/**
+ * \file
+ *
+ * Lexing scripts read from a file descriptor, a window at a
+ * time, instead of from a single buffer holding the whole
+ * script.
+ *
+ * The window only keeps the bytes from the start of the
+ * previous token onwards, so files and pipes of any size can
+ * be lexed in the window's memory. The window only grows if a
+ * single token doesn't fit in it.
+ */
+
+/**
+ * \brief The default size of a stream's window, in bytes.
+ */
+#define DESCENT_XML_STREAM_WINDOW 65536
+
+/**
+ * \brief A script being read from a file descriptor.
+ */
+struct descent_xml_stream {
+	/**
+	 * \brief The file descriptor being read from.
+	 */
+	int fd;
+
+	/**
+	 * \brief The errno value from a failed read, or 0.
+	 */
+	int error;
+
+	/**
+	 * \brief Whether the end of the file has been read.
+	 */
+	bool eof;
+
+	/**
+	 * \brief The push lexer fed from the window.
+	 */
+	struct descent_xml_lex_push push;
+
+	char *_buffer;
+	size_t _length;
+	size_t _capacity;
+};
+
+/**
+ * \brief Initializes a stream.
+ *
+ * The stream doesn't take ownership of fd; close it after
+ * calling descent_xml_stream_free().
+ *
+ * \param stream The stream to initialize.
+ * \param fd The file descriptor to read from.
+ * \param window The initial size of the window, in bytes, or
+ * 	0 for DESCENT_XML_STREAM_WINDOW.
+ *
+ * \returns 0 on success, or -1 if the window couldn't be
+ * 	allocated.
+ */
+int descent_xml_stream_init(
+	struct descent_xml_stream *stream,
+	int fd,
+	size_t window
+);
+
+/**
+ * \brief Releases a stream's window.
+ *
+ * \param stream The stream to release.
+ */
+void descent_xml_stream_free(struct descent_xml_stream *stream);
+
+/**
+ * \brief Returns the next raw token from a stream.
+ *
+ * This reads from the stream's file descriptor as needed,
+ * and never returns a descent_xml_lex_need_input token.
+ *
+ * The token's value and script point into the stream's
+ * window, and are only valid until the next call.
+ *
+ * \param stream The stream to read from.
+ *
+ * \returns The next token, the same as descent_xml_lex_next_raw()
+ * 	would return for the whole file. If reading fails, or
+ * 	the window can't grow to fit a token, this returns a
+ * 	descent_xml_classifier_unexpected token and sets
+ * 	stream->error.
+ */
+struct descent_xml_lex descent_xml_stream_next(
+	struct descent_xml_stream *stream
+);
+
+/**
+ * \brief Validates the rest of a stream as an XML document.
+ *
+ * \param stream The stream to validate, from its start.
+ * \param depth The maximum number of nested elements, or a
+ * 	negative number for no limit.
+ *
+ * \returns Whether the document is valid, as for
+ * 	descent_xml_validate_document_depth(). Read errors
+ * 	make the document invalid, and set stream->error.
+ */
+bool descent_xml_stream_validate_depth(
+	struct descent_xml_stream *stream,
+	int depth
+);
+
+/**
+ * \brief Validates the rest of a stream as an XML document,
+ * 	with a reasonable depth limit.
+ *
+ * \param stream The stream to validate, from its start.
+ *
+ * \returns Whether the document is valid.
+ */
+bool descent_xml_stream_validate(struct descent_xml_stream *stream);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // DESCENT_XML_STREAM
@@ -32,254 +32,807 @@ extern "C" {
 
 /**
  * \file
+ *
+ * Checking that a script is a well-formed XML document.
+ *
+ * All of the validators here share the same state machine,
+ * descent_xml_validate_step(), and keep the names of open
+ * elements on a stack on the heap instead of on the C stack,
+ * so the depth of a document is only limited by memory and
+ * the depth passed in.
  */
 
-inline struct descent_xml_lex _descent_xml_validate_element_handler(
-	struct descent_xml_lex token,
-	struct libadt_const_lptr element_name,
-	struct libadt_const_lptr attributes,
-	bool empty,
-	void *context_p
-)
+inline bool _descent_xml_non_space_text(struct descent_xml_lex token)
 {
-	(void)attributes;
-	struct {
-		bool valid;
-		int depth;
-	} *context = context_p;
-	if (context->depth == 0) {
-		context->valid = false;
-		return token;
-	}
-	context->depth--;
+	return token.type == descent_xml_classifier_text
+		|| token.type == descent_xml_classifier_text_entity_start
+		|| token.type == descent_xml_classifier_text_entity
+		|| token.type == descent_xml_lex_cdata;
+}
 
-	const struct libadt_const_lptr xmldecl = libadt_str_literal("?xml");
+/**
+ * \brief The state of a validator that's fed one token at a time.
+ *
+ * Unlike descent_xml_validate_document(), which pulls tokens
+ * from a complete script itself, this validates tokens as they
+ * are handed to descent_xml_validate_step(), for scripts that
+ * aren't all in memory at once, such as those read with
+ * descent_xml_stream_next().
+ *
+ * The names of open elements are copied, so tokens don't
+ * need to stay valid after they've been stepped over.
+ * descent_xml_validate_document() and
+ * descent_xml_validate_element() have the whole script, so
+ * they only keep pointers to the names instead.
+ *
+ * Initialize with descent_xml_validate_state_init() and
+ * release with descent_xml_validate_state_free().
+ */
+struct descent_xml_validate_state {
+	/**
+	 * \brief Whether the tokens so far are valid.
+	 */
+	bool valid;
+
+	/**
+	 * \brief Whether the end of the script has been reached.
+	 */
+	bool done;
+
+	/**
+	 * \brief The maximum number of nested elements, or
+	 * 	a negative number for no limit.
+	 */
+	int depth;
+
+	// Where we are in the document
+	enum {
+		_DESCENT_XML_VALIDATE_PROLOG,
+		_DESCENT_XML_VALIDATE_ROOT,
+		_DESCENT_XML_VALIDATE_EPILOG,
+	} _stage;
+	bool _markup;
+	bool _seen_markup;
+	bool _seen_doctype;
+
+	// The number of open elements
+	size_t _open;
+
+	// The names of the open elements, end to end,
+	// and where each one ends
+	char *_names;
+	size_t _names_length;
+	size_t _names_capacity;
+	size_t *_ends;
+	size_t _ends_capacity;
+
+	// Or, if the script outlives the validator,
+	// pointers to the names in the script
+	bool _borrow;
+	struct libadt_const_lptr *_spans;
+	size_t _spans_capacity;
+
+	// The last token seen by descent_xml_validate_parse()
+	struct descent_xml_lex _last;
+
+	// The token after the end of the last text run, which
+	// had to be lexed to find the end, and the token it
+	// follows
+	struct descent_xml_lex _ahead;
+	struct descent_xml_lex _ahead_of;
+};
 
-	if (libadt_const_lptr_equal(element_name, xmldecl)) {
-		context->valid = false;
-		return token;
-	}
+/**
+ * \brief Initializes a step validator.
+ *
+ * \param depth The maximum number of nested elements
+ * 	to allow, or a negative number for no limit.
+ *
+ * \returns The validator's state.
+ */
+inline struct descent_xml_validate_state descent_xml_validate_state_init(
+	int depth
+)
+{
+	return (struct descent_xml_validate_state) {
+		.valid = true,
+		.depth = depth,
+	};
+}
 
-	if (empty)
-		return token;
-
-	while (token.type != descent_xml_classifier_element_close_name) {
-		if (
-			token.type == descent_xml_classifier_unexpected
-			|| token.type == descent_xml_classifier_eof
-			|| token.type == descent_xml_lex_xmldecl
-			|| token.type == descent_xml_lex_doctype
-			|| !context->valid
-		) {
-			context->valid = false;
-			return token;
-		}
-		token = descent_xml_parse(
-			token,
-			_descent_xml_validate_element_handler,
-			NULL,
-			context
+/**
+ * \brief Releases the memory held by a step validator.
+ *
+ * \param state The validator to release.
+ */
+inline void descent_xml_validate_state_free(
+	struct descent_xml_validate_state *state
+)
+{
+	free(state->_names);
+	free(state->_ends);
+	free(state->_spans);
+	state->_names = NULL;
+	state->_ends = NULL;
+	state->_spans = NULL;
+}
+
+inline bool _descent_xml_validate_push_span(
+	struct descent_xml_validate_state *state,
+	struct libadt_const_lptr name
+)
+{
+	if (state->_open == state->_spans_capacity) {
+		const size_t capacity = state->_spans_capacity
+			? state->_spans_capacity * 2
+			: 32;
+		struct libadt_const_lptr *const spans = realloc(
+			state->_spans,
+			capacity * sizeof(*spans)
 		);
+		if (!spans)
+			return false;
+		state->_spans = spans;
+		state->_spans_capacity = capacity;
 	}
 
-	context->valid = libadt_const_lptr_equal(
-		token.value,
-		element_name
-	);
-	context->depth++;
-	token = descent_xml_parse(token, NULL, NULL, NULL);
-	return token;
+	state->_spans[state->_open++] = name;
+	return true;
 }
 
-inline bool descent_xml_validate_element_depth(
-	struct descent_xml_lex token,
-	int depth
+inline bool _descent_xml_validate_push_name(
+	struct descent_xml_validate_state *state,
+	struct libadt_const_lptr name
 )
 {
-	struct {
-		bool valid;
-		int depth;
-	} context = { true, depth };
-	while (token.type != descent_xml_classifier_element) {
-		if (
-			token.type == descent_xml_classifier_unexpected
-			|| token.type == descent_xml_classifier_eof
-		)
+	if (state->_borrow)
+		return _descent_xml_validate_push_span(state, name);
+
+	const size_t length = (size_t)name.length;
+
+	if (state->_names_length + length > state->_names_capacity) {
+		size_t capacity = state->_names_capacity
+			? state->_names_capacity * 2
+			: 256;
+		while (capacity < state->_names_length + length)
+			capacity *= 2;
+		char *const names = realloc(state->_names, capacity);
+		if (!names)
 			return false;
-		token = descent_xml_lex_next_raw(token);
+		state->_names = names;
+		state->_names_capacity = capacity;
+	}
+
+	if (state->_open == state->_ends_capacity) {
+		const size_t capacity = state->_ends_capacity
+			? state->_ends_capacity * 2
+			: 32;
+		size_t *const ends = realloc(
+			state->_ends,
+			capacity * sizeof(*ends)
+		);
+		if (!ends)
+			return false;
+		state->_ends = ends;
+		state->_ends_capacity = capacity;
 	}
-	token = descent_xml_parse(
-		token,
-		_descent_xml_validate_element_handler,
-		NULL,
-		&context
-	);
 
-	// We have to check for unexpected/eof here in case the
-	// element handler never runs
-	return
-		context.valid
-		&& token.type != descent_xml_classifier_unexpected
-		&& token.type != descent_xml_classifier_eof;
+	memcpy(state->_names + state->_names_length, name.buffer, length);
+	state->_names_length += length;
+	state->_ends[state->_open++] = state->_names_length;
+	return true;
 }
 
-inline bool descent_xml_validate_element(struct descent_xml_lex token)
+inline struct libadt_const_lptr _descent_xml_validate_top_name(
+	const struct descent_xml_validate_state *state
+)
 {
-	return descent_xml_validate_element_depth(token, 10000);
+	if (state->_borrow)
+		return state->_spans[state->_open - 1];
+
+	const size_t end = state->_ends[state->_open - 1];
+	const size_t start = state->_open > 1
+		? state->_ends[state->_open - 2]
+		: 0;
+	return (struct libadt_const_lptr) {
+		.buffer = state->_names + start,
+		.size = sizeof(char),
+		.length = (ssize_t)(end - start),
+	};
 }
 
-inline bool _descent_xml_non_space_text(struct descent_xml_lex token)
+inline void _descent_xml_validate_pop_name(
+	struct descent_xml_validate_state *state
+)
 {
-	return token.type == descent_xml_classifier_text
-		|| token.type == descent_xml_classifier_text_entity_start
-		|| token.type == descent_xml_classifier_text_entity
-		|| token.type == descent_xml_lex_cdata;
+	state->_open--;
+	if (!state->_borrow)
+		state->_names_length = state->_open
+			? state->_ends[state->_open - 1]
+			: 0;
+	if (!state->_open)
+		state->_stage = _DESCENT_XML_VALIDATE_EPILOG;
 }
 
-inline struct descent_xml_lex _descent_xml_validate_prolog_goto_element(
+// Handles the token after a '<'
+inline bool _descent_xml_validate_step_markup(
+	struct descent_xml_validate_state *state,
 	struct descent_xml_lex token
 )
 {
-	while (token.type != descent_xml_classifier_element) {
-		if (
-			token.type == descent_xml_classifier_unexpected
-			|| token.type == descent_xml_classifier_eof
-			|| _descent_xml_non_space_text(token)
-		)
-			return token;
-		token = descent_xml_lex_next_raw(token);
+	const bool prolog = state->_stage == _DESCENT_XML_VALIDATE_PROLOG;
+	const bool root = state->_stage == _DESCENT_XML_VALIDATE_ROOT;
+	const bool first = !state->_seen_markup;
+	state->_seen_markup = true;
+
+	if (token.type == descent_xml_lex_xmldecl)
+		return prolog && first;
+
+	if (token.type == descent_xml_lex_doctype) {
+		const bool valid = prolog && !state->_seen_doctype;
+		state->_seen_doctype = true;
+		return valid;
 	}
-	return token;
+
+	if (token.type == descent_xml_lex_comment)
+		return prolog || root;
+
+	if (token.type == descent_xml_lex_cdata)
+		return root;
+
+	if (token.type == descent_xml_classifier_element_close)
+		return root;
+
+	if (token.type == descent_xml_classifier_element_name) {
+		if (!prolog && !root)
+			return false;
+		if (state->depth >= 0 && state->_open >= (size_t)state->depth)
+			return false;
+		if (libadt_const_lptr_equal(token.value, libadt_str_literal("?xml")))
+			return false;
+
+		state->_stage = _DESCENT_XML_VALIDATE_ROOT;
+		return _descent_xml_validate_push_name(state, token.value);
+	}
+
+	return false;
 }
 
-inline struct descent_xml_lex _descent_xml_validate_prolog_comments(
+/**
+ * \brief Feeds a single token to a step validator.
+ *
+ * Tokens must be passed in order, starting from the first
+ * token after descent_xml_lex_init(), up to and including
+ * the descent_xml_classifier_eof token.
+ *
+ * This accepts the same documents as
+ * descent_xml_validate_document_depth().
+ *
+ * \param state The validator's state.
+ * \param token The next raw token from the script.
+ *
+ * \returns false if the document is invalid, true otherwise.
+ * 	The document is only fully valid once the
+ * 	descent_xml_classifier_eof token has been stepped
+ * 	over, setting state->done, and this still returns true.
+ * 	Running out of memory is treated as an invalid document.
+ */
+inline bool descent_xml_validate_step(
+	struct descent_xml_validate_state *state,
 	struct descent_xml_lex token
 )
 {
-	if (token.type != descent_xml_classifier_element) {
-		token.type = descent_xml_classifier_unexpected;
-		return token;
+	if (!state->valid || state->done)
+		return state->valid;
+
+	if (state->_markup) {
+		state->_markup = false;
+		state->valid = _descent_xml_validate_step_markup(state, token);
+		return state->valid;
 	}
 
-	struct descent_xml_lex next = descent_xml_lex_next_raw(token);
-	if (next.type == descent_xml_lex_comment) {
-		token = descent_xml_lex_then(
-			next,
-			_descent_xml_validate_prolog_goto_element
-		);
-		token = descent_xml_lex_optional(
-			token,
-			_descent_xml_validate_prolog_comments
+	if (token.type == descent_xml_classifier_eof) {
+		state->done = true;
+		state->valid = state->_stage == _DESCENT_XML_VALIDATE_EPILOG;
+	} else if (token.type == descent_xml_classifier_unexpected) {
+		state->valid = false;
+	} else if (token.type == descent_xml_classifier_element) {
+		state->_markup = true;
+		state->valid = state->_stage != _DESCENT_XML_VALIDATE_EPILOG;
+	} else if (token.type == descent_xml_classifier_element_empty) {
+		_descent_xml_validate_pop_name(state);
+	} else if (token.type == descent_xml_classifier_element_close_name) {
+		state->valid = libadt_const_lptr_equal(
+			token.value,
+			_descent_xml_validate_top_name(state)
 		);
+		_descent_xml_validate_pop_name(state);
+	} else if (_descent_xml_non_space_text(token)) {
+		state->valid = state->_stage == _DESCENT_XML_VALIDATE_ROOT;
 	}
-	return token;
+
+	return state->valid;
 }
 
-inline struct descent_xml_lex _descent_xml_validate_xmldecl(
+// Steps over the tokens after token until the end of the
+// script, or until the state is invalid
+inline void _descent_xml_validate_run(
+	struct descent_xml_validate_state *state,
 	struct descent_xml_lex token
 )
 {
-	struct descent_xml_lex next = descent_xml_lex_next_raw(token);
+	do {
+		token = descent_xml_lex_next_raw(token);
+	} while (descent_xml_validate_step(state, token) && !state->done);
+}
 
-	if (next.type == descent_xml_lex_xmldecl) {
-		token = descent_xml_lex_then(
-			next,
-			_descent_xml_validate_prolog_goto_element
-		);
-	}
+/**
+ * \brief Validates an XML document.
+ *
+ * \param token A token at the start of the document, from
+ * 	descent_xml_lex_init().
+ * \param depth The maximum number of nested elements, or a
+ * 	negative number for no limit.
+ *
+ * \returns Whether the document is valid. Running out of
+ * 	memory for the names of open elements is treated as
+ * 	an invalid document.
+ */
+inline bool descent_xml_validate_document_depth(
+	struct descent_xml_lex token,
+	int depth
+)
+{
+	struct descent_xml_validate_state state
+		= descent_xml_validate_state_init(depth);
+	state._borrow = true;
 
-	return token;
+	_descent_xml_validate_run(&state, token);
+
+	descent_xml_validate_state_free(&state);
+	return state.valid;
 }
 
-inline struct descent_xml_lex _descent_xml_validate_doctype(
+/**
+ * \brief Validates an XML document, with a reasonable depth limit.
+ *
+ * \param token A token at the start of the document, from
+ * 	descent_xml_lex_init().
+ *
+ * \returns Whether the document is valid.
+ */
+inline bool descent_xml_validate_document(
 	struct descent_xml_lex token
 )
 {
-	struct descent_xml_lex next = descent_xml_lex_next_raw(token);
+	return descent_xml_validate_document_depth(token, 1000);
+}
 
-	if (next.type == descent_xml_lex_doctype) {
-		token = descent_xml_lex_then(
-			next,
-			_descent_xml_validate_prolog_goto_element
-		);
+/**
+ * \brief Validates the first element after token.
+ *
+ * Anything before the element is skipped, and anything after
+ * it isn't looked at. The element can't contain an XML
+ * declaration or a doctype.
+ *
+ * \param token A token before the element.
+ * \param depth The maximum number of nested elements, or a
+ * 	negative number for no limit.
+ *
+ * \returns Whether the element is valid.
+ */
+inline bool descent_xml_validate_element_depth(
+	struct descent_xml_lex token,
+	int depth
+)
+{
+	while (token.type != descent_xml_classifier_element) {
+		if (_descent_xml_end_token(token))
+			return false;
+		token = descent_xml_lex_next_raw(token);
 	}
 
-	return token;
+	token = descent_xml_lex_next_raw(token);
+	if (token.type != descent_xml_classifier_element_name)
+		return !_descent_xml_end_token(token);
+
+	// Start as if the '<' were inside the document, after
+	// its prolog, and stop when the element is closed
+	struct descent_xml_validate_state state
+		= descent_xml_validate_state_init(depth);
+	state._borrow = true;
+	state._markup = true;
+	state._seen_markup = true;
+	state._seen_doctype = true;
+
+	while (
+		descent_xml_validate_step(&state, token)
+		&& state._stage != _DESCENT_XML_VALIDATE_EPILOG
+	)
+		token = descent_xml_lex_next_raw(token);
+
+	// a closing tag still needs its '>'
+	if (state.valid && token.type == descent_xml_classifier_element_close_name)
+		token = descent_xml_lex_next_raw(token);
+
+	descent_xml_validate_state_free(&state);
+	return state.valid && !_descent_xml_end_token(token);
 }
 
-inline struct descent_xml_lex _descent_xml_validate_parse_prolog(
+/**
+ * \brief Validates the first element after token, with a
+ * 	reasonable depth limit.
+ *
+ * \param token A token before the element.
+ *
+ * \returns Whether the element is valid.
+ */
+inline bool descent_xml_validate_element(struct descent_xml_lex token)
+{
+	return descent_xml_validate_element_depth(token, 10000);
+}
+
+/**
+ * \brief The token type returned by descent_xml_validate_parse()
+ * 	when the document isn't well-formed.
+ *
+ * Like descent_xml_parse_error, this is only used to mark
+ * tokens, and calling it aborts.
+ */
+descent_xml_classifier_void_fn *descent_xml_validate_error(wchar_t input);
+
+inline struct descent_xml_lex _descent_xml_validate_fail(
+	struct descent_xml_validate_state *state,
 	struct descent_xml_lex token
 )
 {
-	token = descent_xml_lex_then(
-		token,
-		_descent_xml_validate_prolog_goto_element
-	);
-	token = descent_xml_lex_optional(
-		token,
-		_descent_xml_validate_xmldecl
-	);
-	token = descent_xml_lex_optional(
-		token,
-		_descent_xml_validate_prolog_comments
-	);
-	token = descent_xml_lex_optional(
-		token,
-		_descent_xml_validate_doctype
-	);
-	token = descent_xml_lex_optional(
-		token,
-		_descent_xml_validate_prolog_comments
-	);
+	state->valid = false;
+	token.type = descent_xml_validate_error;
 	return token;
 }
 
-inline bool descent_xml_validate_document_depth(
-	struct descent_xml_lex token,
-	int depth
+inline const char *_descent_xml_validate_end(struct descent_xml_lex token)
+{
+	return (const char *)token.value.buffer + token.value.length;
+}
+
+// Steps over a token, and remembers it as the last one seen
+inline bool _descent_xml_validate_record(
+	struct descent_xml_validate_state *state,
+	struct descent_xml_lex token
+)
+{
+	state->_last = token;
+	return descent_xml_validate_step(state, token);
+}
+
+// Steps over any tokens between the last one the validator
+// saw and token, which a handler lexed without telling it.
+// Returns false if token should be marked as invalid.
+inline bool _descent_xml_validate_catch_up(
+	struct descent_xml_validate_state *state,
+	struct descent_xml_lex token
 )
 {
-	struct {
-		bool valid;
-		int depth;
-	} context = {true, depth};
+	if (!state->_last.script.buffer) {
+		// The whole script is in memory, so there's no
+		// need to copy names
+		if (!state->_open)
+			state->_borrow = true;
+		state->_last = token;
+		return state->valid;
+	}
 
-	token = _descent_xml_validate_parse_prolog(token);
+	// Tokens that are already errors are passed back as
+	// they are
+	if (token.type == descent_xml_classifier_unexpected) {
+		state->valid = false;
+		return true;
+	}
 	if (
-		token.type == descent_xml_classifier_unexpected
-		|| token.type == descent_xml_classifier_eof
+		token.type == descent_xml_parse_error
+		|| token.type == descent_xml_validate_error
 	)
-		return false;
+		return true;
+
+	const char *const end = _descent_xml_validate_end(token);
+	for (;;) {
+		const bool behind = _descent_xml_validate_end(state->_last) < end
+			|| (
+				token.type == descent_xml_classifier_eof
+				&& state->_last.type != descent_xml_classifier_eof
+			);
+		if (!behind || !state->valid || _descent_xml_end_token(state->_last))
+			break;
+
+		_descent_xml_validate_record(
+			state,
+			descent_xml_lex_next_raw(state->_last)
+		);
+	}
+	return state->valid;
+}
+
+inline bool _descent_xml_validate_same(
+	struct descent_xml_lex a,
+	struct descent_xml_lex b
+)
+{
+	return a.type == b.type
+		&& a.value.buffer == b.value.buffer
+		&& a.value.length == b.value.length;
+}
+
+typedef struct {
+	struct descent_xml_validate_state *const state;
+	descent_xml_parse_element_fn *const element_handler;
+	void *const context;
+} _descent_xml_validate_parse_context;
 
-	token = descent_xml_parse(
+inline struct descent_xml_lex _descent_xml_validate_parse_element(
+	struct descent_xml_lex token,
+	struct libadt_const_lptr element_name,
+	struct libadt_const_lptr attributes,
+	bool empty,
+	void *context
+)
+{
+	const _descent_xml_validate_parse_context *const parse_context = context;
+
+	// None of the tokens inside a start tag change the
+	// validator's state, so it only needs to see the last
+	if (!_descent_xml_validate_record(parse_context->state, token))
+		return _descent_xml_validate_fail(parse_context->state, token);
+
+	return parse_context->element_handler(
 		token,
-		_descent_xml_validate_element_handler,
-		NULL,
-		&context
+		element_name,
+		attributes,
+		empty,
+		parse_context->context
 	);
+}
 
-	if (!context.valid)
-		return false;
-
-	// check that there's only one element node in the root
-	while (token.type != descent_xml_classifier_element) {
-		if (token.type == descent_xml_classifier_eof)
-			return true;
-		if (token.type == descent_xml_classifier_unexpected)
-			return false;
-		if (token.type == descent_xml_classifier_text)
-			return false;
-		token = descent_xml_lex_next_raw(token);
+/**
+ * \brief Parses a single entity, as descent_xml_parse_with()
+ * 	does, while validating the document.
+ *
+ * See descent_xml_validate_parse() for how validation works.
+ * Handlers that parse their element's children should pass the
+ * same context on to their own calls.
+ *
+ * \param parse The context to keep memory for elements'
+ * 	attributes in. Passing NULL is the same as calling
+ * 	descent_xml_validate_parse().
+ * \param state A validator from descent_xml_validate_state_init(),
+ * 	used for this document only.
+ * \param xml A token into an XML document.
+ * \param element_handler A callback to call when encountering an
+ * 	opening element tag. Pass a NULL pointer to disable.
+ * \param text_handler A callback to call when encountering a
+ * 	text node. Pass a NULL pointer to disable.
+ * \param context A user-provided pointer that will be passed
+ * 	to the callbacks.
+ *
+ * \returns The last token encountered while parsing, as for
+ * 	descent_xml_validate_parse(). If the `type` is
+ * 	`descent_xml_parse_error`, the memory for an element's
+ * 	attributes couldn't be allocated.
+ */
+inline struct descent_xml_lex descent_xml_validate_parse_with(
+	struct descent_xml_parse_context *parse,
+	struct descent_xml_validate_state *state,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_fn *element_handler,
+	descent_xml_parse_text_fn *text_handler,
+	void *context
+)
+{
+	if (!_descent_xml_validate_catch_up(state, xml))
+		return _descent_xml_validate_fail(state, xml);
+
+	// The token after a text run was lexed to find its end,
+	// so it isn't lexed again
+	if (state->_ahead.type && _descent_xml_validate_same(xml, state->_ahead_of))
+		xml = state->_ahead;
+	else
+		xml = descent_xml_lex_next_raw(xml);
+	state->_ahead.type = NULL;
+	if (!_descent_xml_validate_record(state, xml))
+		return _descent_xml_validate_fail(state, xml);
+
+	if (xml.type == descent_xml_classifier_element_name && element_handler) {
+		_descent_xml_validate_parse_context parse_context = {
+			.state = state,
+			.element_handler = element_handler,
+			.context = context,
+		};
+		xml = _descent_xml_handle_element(
+			parse,
+			xml,
+			_descent_xml_validate_parse_element,
+			&parse_context
+		);
+	} else if (_descent_xml_is_text_type(xml) && text_handler) {
+		struct libadt_const_lptr text = xml.value;
+		struct descent_xml_lex next = descent_xml_lex_next_raw(xml);
+		while (_descent_xml_is_text_type(next)) {
+			if (!_descent_xml_validate_record(state, next))
+				return _descent_xml_validate_fail(state, next);
+			text.length += next.value.length;
+			xml = next;
+			next = descent_xml_lex_next_raw(next);
+		}
+		state->_ahead = next;
+		state->_ahead_of = xml;
+		text_handler(text, false, context);
+	} else if (xml.type == descent_xml_lex_cdata && text_handler) {
+		struct libadt_const_lptr arg
+			= libadt_const_lptr_index(
+				xml.value,
+				sizeof("![CDATA[") - 1
+			);
+		arg = libadt_const_lptr_truncate(
+			arg,
+			arg.length - 2 /* ]] */
+		);
+		text_handler(arg, true, context);
 	}
 
-	return false;
+	if (!_descent_xml_validate_catch_up(state, xml))
+		return _descent_xml_validate_fail(state, xml);
+	return xml;
 }
 
-inline bool descent_xml_validate_document(
-	struct descent_xml_lex token
+/**
+ * \brief Parses a single entity, as descent_xml_parse() does,
+ * 	while validating the document.
+ *
+ * This lets a document be validated and parsed with a single
+ * pass of the lexer, instead of calling
+ * descent_xml_validate_document() before parsing.
+ *
+ * Call this in a loop from a token from descent_xml_lex_init(),
+ * passing the same state each time. Handlers can lex ahead
+ * themselves: if they do it by calling this function with the
+ * same state, for example by passing it through the context,
+ * the tokens they read are only lexed once; otherwise, they're
+ * lexed again to validate them when the handler returns.
+ *
+ * Handlers are called as each entity is reached, so they can
+ * be called for the part of a document before an error.
+ *
+ * \param state A validator from descent_xml_validate_state_init(),
+ * 	used for this document only.
+ * \param xml A token into an XML document.
+ * \param element_handler A callback to call when encountering an
+ * 	opening element tag. Pass a NULL pointer to disable.
+ * \param text_handler A callback to call when encountering a
+ * 	text node. Pass a NULL pointer to disable.
+ * \param context A user-provided pointer that will be passed
+ * 	to the callbacks.
+ *
+ * \returns The last token encountered while parsing, as for
+ * 	descent_xml_parse(). If the document isn't well-formed,
+ * 	the token's `type` is `descent_xml_validate_error`, and
+ * 	state->valid is false. Lexer errors are returned as
+ * 	`descent_xml_classifier_unexpected` tokens, as they
+ * 	are by descent_xml_parse(), and also set state->valid
+ * 	to false. A `descent_xml_classifier_eof` token is only
+ * 	returned for a valid document.
+ *
+ * \sa descent_xml_validate_parse_with() A version that reuses
+ * 	memory for elements with many attributes.
+ */
+inline struct descent_xml_lex descent_xml_validate_parse(
+	struct descent_xml_validate_state *state,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_fn *element_handler,
+	descent_xml_parse_text_fn *text_handler,
+	void *context
 )
 {
-	return descent_xml_validate_document_depth(token, 1000);
+	return descent_xml_validate_parse_with(
+		NULL,
+		state,
+		xml,
+		element_handler,
+		text_handler,
+		context
+	);
+}
+
+/**
+ * \brief Parses a single entity, as descent_xml_parse_cstr_with()
+ * 	does, while validating the document.
+ *
+ * See descent_xml_validate_parse() for how validation works.
+ *
+ * \param parse The context to copy values into. Passing NULL is
+ * 	the same as calling descent_xml_validate_parse_cstr().
+ * \param state A validator from descent_xml_validate_state_init(),
+ * 	used for this document only.
+ * \param xml A token into an XML document.
+ * \param element_handler A callback to call when encountering an
+ * 	opening element tag. Pass a NULL pointer to disable.
+ * \param text_handler A callback to call when encountering a
+ * 	text node. Pass a NULL pointer to disable.
+ * \param context A user-provided pointer that will be passed
+ * 	to the callbacks.
+ *
+ * \returns The last token encountered while parsing, as for
+ * 	descent_xml_validate_parse_cstr().
+ */
+inline struct descent_xml_lex descent_xml_validate_parse_cstr_with(
+	struct descent_xml_parse_context *parse,
+	struct descent_xml_validate_state *state,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_cstr_fn *element_handler,
+	descent_xml_parse_text_cstr_fn *text_handler,
+	void *context
+)
+{
+	_descent_xml_parse_cstr_context cstr_context = {
+		.parse = parse ? parse : &_descent_xml_parse_cstr_buffers,
+		.element_handler = element_handler,
+		.text_handler = text_handler,
+		.context = context,
+	};
+	xml = descent_xml_validate_parse_with(
+		cstr_context.parse,
+		state,
+		xml,
+		_cstr_element_handler,
+		_cstr_text_handler,
+		&cstr_context
+	);
+	if (cstr_context.error)
+		xml.type = descent_xml_parse_error;
+	return xml;
+}
+
+/**
+ * \brief Parses a single entity, as descent_xml_parse_cstr()
+ * 	does, while validating the document.
+ *
+ * See descent_xml_validate_parse() for how validation works.
+ *
+ * \param state A validator from descent_xml_validate_state_init(),
+ * 	used for this document only.
+ * \param xml A token into an XML document.
+ * \param element_handler A callback to call when encountering an
+ * 	opening element tag. Pass a NULL pointer to disable.
+ * \param text_handler A callback to call when encountering a
+ * 	text node. Pass a NULL pointer to disable.
+ * \param context A user-provided pointer that will be passed
+ * 	to the callbacks.
+ *
+ * \returns The last token encountered while parsing, as for
+ * 	descent_xml_parse_cstr(), or a token with the type
+ * 	`descent_xml_validate_error` if the document isn't
+ * 	well-formed. If the `type` is `descent_xml_parse_error`,
+ * 	there was an error allocating memory for a value.
+ *
+ * \sa descent_xml_validate_parse_cstr_with() A version that copies
+ * 	values into a context of the caller's, instead of memory
+ * 	kept by the calling thread.
+ */
+inline struct descent_xml_lex descent_xml_validate_parse_cstr(
+	struct descent_xml_validate_state *state,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_cstr_fn *element_handler,
+	descent_xml_parse_text_cstr_fn *text_handler,
+	void *context
+)
+{
+	return descent_xml_validate_parse_cstr_with(
+		NULL,
+		state,
+		xml,
+		element_handler,
+		text_handler,
+		context
+	);
 }
 
 #ifdef __cplusplus
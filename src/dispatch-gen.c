@@ -0,0 +1,389 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <descent-xml.h>
+
+typedef struct libadt_const_lptr cptr_t;
+typedef struct descent_xml_dispatch_table table_t;
+
+// Names per bucket, on average. Smaller buckets are quicker to
+// place but need more displacements.
+#define BUCKET_SIZE 4
+
+// Displacements to try for one bucket before giving up on a seed
+#define DISPLACEMENT_TRIES 65536u
+
+// Seeds to try before giving up on the names
+#define SEED_TRIES 1024u
+
+typedef struct {
+	cptr_t *names;
+	size_t count;
+	size_t capacity;
+	char *text;
+} names_t;
+
+static void usage(const char *const program)
+{
+	fprintf(stderr, "Usage: %s PREFIX NAMES OUTPUT\n", program);
+	fprintf(stderr, "\nGenerates a header with a perfect hash table of the element\n");
+	fprintf(stderr, "names in NAMES, one per line, for descent_xml_dispatch_element().\n");
+	fprintf(stderr, "Blank lines and lines starting with # are ignored.\n");
+}
+
+// Returns NULL if the file couldn't be read, or memory allocated
+static char *read_file(FILE *file)
+{
+	size_t length = 0, capacity = 4096;
+	char *text = malloc(capacity);
+	while (text) {
+		length += fread(text + length, 1, capacity - length - 1, file);
+		if (ferror(file)) {
+			free(text);
+			return NULL;
+		}
+		if (length < capacity - 1)
+			break;
+		char *const grown = realloc(text, capacity * 2);
+		if (!grown)
+			free(text);
+		text = grown;
+		capacity *= 2;
+	}
+	if (text)
+		text[length] = '\0';
+	return text;
+}
+
+static bool same(cptr_t a, cptr_t b)
+{
+	return a.length == b.length
+		&& !memcmp(a.buffer, b.buffer, (size_t)a.length);
+}
+
+// Splits text into lines in place, trimming surrounding whitespace
+static bool split_names(names_t *names)
+{
+	char *line = names->text;
+	while (*line) {
+		char *end = strchr(line, '\n');
+		char *const next = end ? end + 1 : line + strlen(line);
+		if (!end)
+			end = next;
+
+		while (line < end && isspace((unsigned char)*line))
+			line++;
+		while (end > line && isspace((unsigned char)end[-1]))
+			end--;
+
+		if (line < end && *line != '#') {
+			const cptr_t name = {
+				.buffer = line,
+				.size = sizeof(char),
+				.length = end - line,
+			};
+			for (size_t i = 0; i < names->count; i++) {
+				if (same(names->names[i], name)) {
+					fprintf(stderr, "Duplicate name: %.*s\n",
+						(int)name.length, line);
+					return false;
+				}
+			}
+			if (names->count == names->capacity) {
+				names->capacity = names->capacity ? names->capacity * 2 : 64;
+				cptr_t *const grown = realloc(
+					names->names,
+					names->capacity * sizeof(cptr_t)
+				);
+				if (!grown)
+					return false;
+				names->names = grown;
+			}
+			names->names[names->count++] = name;
+		}
+
+		line = next;
+	}
+
+	if (!names->count) {
+		fprintf(stderr, "No names given\n");
+		return false;
+	}
+	return true;
+}
+
+// Writes the C identifier form of a name: letters and digits
+// upper-cased, everything else an underscore
+static void write_identifier(FILE *output, cptr_t name)
+{
+	const unsigned char *const bytes = name.buffer;
+	for (ssize_t i = 0; i < name.length; i++) {
+		const int c = bytes[i];
+		fputc(c < 0x80 && isalnum(c) ? toupper(c) : '_', output);
+	}
+}
+
+static bool same_identifier(cptr_t a, cptr_t b)
+{
+	if (a.length != b.length)
+		return false;
+
+	const unsigned char *const x = a.buffer, *const y = b.buffer;
+	for (ssize_t i = 0; i < a.length; i++) {
+		const int c = x[i] < 0x80 && isalnum(x[i]) ? toupper(x[i]) : '_';
+		const int d = y[i] < 0x80 && isalnum(y[i]) ? toupper(y[i]) : '_';
+		if (c != d)
+			return false;
+	}
+	return true;
+}
+
+static void write_string(FILE *output, cptr_t name)
+{
+	const unsigned char *const bytes = name.buffer;
+	fputc('"', output);
+	for (ssize_t i = 0; i < name.length; i++) {
+		if (bytes[i] < 0x80 && isalnum(bytes[i]))
+			fputc(bytes[i], output);
+		else
+			fprintf(output, "\\%03o", bytes[i]);
+	}
+	fputc('"', output);
+}
+
+// Places every name with the table's seed, largest buckets first.
+// Returns false if a bucket couldn't be placed.
+static bool place(
+	table_t *table,
+	const names_t *names,
+	uint32_t *displacements,
+	int32_t *slots
+)
+{
+	const size_t slot_count = (size_t)table->mask + 1;
+	uint64_t *const hashes = malloc(names->count * sizeof(*hashes));
+	size_t *const order = malloc(names->count * sizeof(*order));
+	size_t *const sizes = calloc(table->buckets, sizeof(*sizes));
+	size_t *const starts = calloc(table->buckets + 1, sizeof(*starts));
+	uint32_t *const tried = malloc(names->count * sizeof(*tried));
+	bool placed = hashes && order && sizes && starts && tried;
+	if (!placed)
+		goto done;
+
+	// Sort the names by bucket
+	for (size_t i = 0; i < names->count; i++) {
+		hashes[i] = descent_xml_dispatch_hash(names->names[i], table->seed);
+		sizes[descent_xml_dispatch_bucket(table, hashes[i])]++;
+	}
+	for (uint32_t b = 0; b < table->buckets; b++)
+		starts[b + 1] = starts[b] + sizes[b];
+	for (size_t i = 0; i < names->count; i++) {
+		const uint32_t b = descent_xml_dispatch_bucket(table, hashes[i]);
+		order[starts[b] + --sizes[b]] = i;
+	}
+	for (uint32_t b = 0; b < table->buckets; b++)
+		sizes[b] = starts[b + 1] - starts[b];
+
+	for (size_t s = 0; s < slot_count; s++)
+		slots[s] = -1;
+	for (uint32_t b = 0; b < table->buckets; b++)
+		displacements[b] = 0;
+
+	for (size_t size = names->count; size > 0 && placed; size--) {
+		for (uint32_t b = 0; b < table->buckets && placed; b++) {
+			if (sizes[b] != size)
+				continue;
+
+			const size_t *const members = order + starts[b];
+			uint32_t d = 0;
+			for (; d < DISPLACEMENT_TRIES; d++) {
+				size_t m = 0;
+				for (; m < size; m++) {
+					tried[m] = descent_xml_dispatch_slot(
+						table,
+						hashes[members[m]],
+						d
+					);
+					if (slots[tried[m]] >= 0)
+						break;
+					size_t k = 0;
+					while (k < m && tried[k] != tried[m])
+						k++;
+					if (k < m)
+						break;
+				}
+				if (m == size)
+					break;
+			}
+
+			if (d == DISPLACEMENT_TRIES) {
+				placed = false;
+				break;
+			}
+
+			displacements[b] = d;
+			for (size_t m = 0; m < size; m++)
+				slots[tried[m]] = (int32_t)members[m];
+		}
+	}
+
+done:
+	free(hashes);
+	free(order);
+	free(sizes);
+	free(starts);
+	free(tried);
+	return placed;
+}
+
+static void write_header(
+	FILE *output,
+	const char *const prefix,
+	const names_t *names,
+	const table_t *table,
+	const uint32_t *displacements,
+	const int32_t *slots
+)
+{
+	const cptr_t upper = {
+		.buffer = prefix,
+		.size = sizeof(char),
+		.length = (ssize_t)strlen(prefix),
+	};
+
+	fprintf(output, "// Generated by descent-xml-dispatch-gen. Do not edit.\n\n");
+	fprintf(output, "#ifndef ");
+	write_identifier(output, upper);
+	fprintf(output, "_DISPATCH\n#define ");
+	write_identifier(output, upper);
+	fprintf(output, "_DISPATCH\n\n");
+	fprintf(output, "#include <descent-xml/dispatch.h>\n\n");
+
+	fprintf(output, "enum %s_name {\n", prefix);
+	for (size_t i = 0; i < names->count; i++) {
+		fputc('\t', output);
+		write_identifier(output, upper);
+		fputc('_', output);
+		write_identifier(output, names->names[i]);
+		fprintf(output, ",\n");
+	}
+	fputc('\t', output);
+	write_identifier(output, upper);
+	fprintf(output, "_COUNT\n};\n\n");
+
+	fprintf(output, "static const uint32_t %s_displacements[] = {", prefix);
+	for (uint32_t b = 0; b < table->buckets; b++)
+		fprintf(output, "%s%u,", b % 8 ? " " : "\n\t", displacements[b]);
+	fprintf(output, "\n};\n\n");
+
+	fprintf(output, "static const int32_t %s_slots[] = {", prefix);
+	for (uint32_t s = 0; s <= table->mask; s++)
+		fprintf(output, "%s%d,", s % 8 ? " " : "\n\t", slots[s]);
+	fprintf(output, "\n};\n\n");
+
+	fprintf(output, "static const struct libadt_const_lptr %s_names[] = {\n", prefix);
+	for (size_t i = 0; i < names->count; i++) {
+		fprintf(output, "\t{ ");
+		write_string(output, names->names[i]);
+		fprintf(output, ", sizeof(char), %zd },\n", names->names[i].length);
+	}
+	fprintf(output, "};\n\n");
+
+	fprintf(output, "static const struct descent_xml_dispatch_table %s_table = {\n", prefix);
+	fprintf(output, "\t.seed = %uu,\n", table->seed);
+	fprintf(output, "\t.buckets = %uu,\n", table->buckets);
+	fprintf(output, "\t.mask = %uu,\n", table->mask);
+	fprintf(output, "\t.displacements = %s_displacements,\n", prefix);
+	fprintf(output, "\t.slots = %s_slots,\n", prefix);
+	fprintf(output, "\t.names = %s_names,\n", prefix);
+	fprintf(output, "\t.count = %zu,\n", names->count);
+	fprintf(output, "};\n\n");
+
+	fprintf(output, "#endif\n");
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 4) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	const char *const prefix = argv[1];
+	for (const char *c = prefix; *c; c++) {
+		if (!isalnum((unsigned char)*c) && *c != '_') {
+			fprintf(stderr, "Prefix isn't a C identifier: %s\n", prefix);
+			return 2;
+		}
+	}
+
+	FILE *input = fopen(argv[2], "r");
+	if (!input) {
+		perror(argv[2]);
+		return 1;
+	}
+	names_t names = { .text = read_file(input) };
+	fclose(input);
+	if (!names.text) {
+		fprintf(stderr, "Couldn't read %s\n", argv[2]);
+		return 1;
+	}
+	if (!split_names(&names))
+		return 1;
+
+	for (size_t i = 0; i < names.count; i++) {
+		for (size_t j = 0; j < i; j++) {
+			if (same_identifier(names.names[i], names.names[j])) {
+				fprintf(stderr, "Names %.*s and %.*s have the same constant\n",
+					(int)names.names[j].length,
+					(const char *)names.names[j].buffer,
+					(int)names.names[i].length,
+					(const char *)names.names[i].buffer);
+				return 1;
+			}
+		}
+	}
+
+	size_t slot_count = 1;
+	while (slot_count < names.count)
+		slot_count *= 2;
+
+	table_t table = {
+		.buckets = (uint32_t)((names.count + BUCKET_SIZE - 1) / BUCKET_SIZE),
+		.mask = (uint32_t)(slot_count - 1),
+		.count = names.count,
+	};
+	uint32_t *const displacements = malloc(table.buckets * sizeof(uint32_t));
+	int32_t *const slots = malloc(slot_count * sizeof(int32_t));
+	if (!displacements || !slots)
+		return 1;
+
+	bool placed = false;
+	for (uint32_t seed = 0; seed < SEED_TRIES && !placed; seed++) {
+		table.seed = seed;
+		placed = place(&table, &names, displacements, slots);
+	}
+	if (!placed) {
+		fprintf(stderr, "Couldn't find a perfect hash for %s\n", argv[2]);
+		return 1;
+	}
+
+	FILE *output = fopen(argv[3], "w");
+	if (!output) {
+		perror(argv[3]);
+		return 1;
+	}
+	write_header(output, prefix, &names, &table, displacements, slots);
+	if (fclose(output)) {
+		perror(argv[3]);
+		return 1;
+	}
+
+	free(displacements);
+	free(slots);
+	free(names.names);
+	free(names.text);
+	return 0;
+}
@@ -0,0 +1,26 @@
+#include "descent-xml/dispatch.h"
+
+uint64_t descent_xml_dispatch_hash(
+	struct libadt_const_lptr name,
+	uint32_t seed
+);
+uint32_t descent_xml_dispatch_slot(
+	const struct descent_xml_dispatch_table *table,
+	uint64_t hash,
+	uint32_t displacement
+);
+uint32_t descent_xml_dispatch_bucket(
+	const struct descent_xml_dispatch_table *table,
+	uint64_t hash
+);
+ssize_t descent_xml_dispatch_find(
+	const struct descent_xml_dispatch_table *table,
+	struct libadt_const_lptr name
+);
+struct descent_xml_lex descent_xml_dispatch_element(
+	struct descent_xml_lex token,
+	struct libadt_const_lptr element_name,
+	struct libadt_const_lptr attributes,
+	bool empty,
+	void *dispatch
+);
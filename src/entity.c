@@ -0,0 +1,11 @@
+#include "descent-xml/entity.h"
+
+size_t _descent_xml_entity_utf8(uint32_t code_point, char *buffer);
+size_t _descent_xml_entity_reference(
+	struct libadt_const_lptr name,
+	char *buffer
+);
+struct libadt_const_lptr descent_xml_entity_decode(
+	struct libadt_const_lptr string,
+	char *buffer
+);
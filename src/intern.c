@@ -0,0 +1,31 @@
+#include "descent-xml/intern.h"
+
+struct descent_xml_intern descent_xml_intern_init(void);
+void descent_xml_intern_free(struct descent_xml_intern *table);
+uint32_t _descent_xml_intern_hash(struct libadt_const_lptr name);
+struct libadt_const_lptr descent_xml_intern_name(
+	const struct descent_xml_intern *table,
+	size_t id
+);
+size_t _descent_xml_intern_probe(
+	const struct descent_xml_intern *table,
+	struct libadt_const_lptr name,
+	uint32_t hash
+);
+ssize_t descent_xml_intern_find(
+	const struct descent_xml_intern *table,
+	struct libadt_const_lptr name
+);
+void _descent_xml_intern_place(
+	struct descent_xml_intern *table,
+	size_t id
+);
+bool _descent_xml_intern_grow_slots(struct descent_xml_intern *table);
+bool _descent_xml_intern_reserve(
+	struct descent_xml_intern *table,
+	size_t length
+);
+ssize_t descent_xml_intern_add(
+	struct descent_xml_intern *table,
+	struct libadt_const_lptr name
+);
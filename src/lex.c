@@ -2,27 +2,89 @@
 
 #include "descent-xml/classifier.h"
 
+#include <stdint.h>
 #include <wchar.h>
 #include <wctype.h>
 
 typedef descent_xml_classifier_void_fn vfn;
 
+ssize_t _descent_xml_lex_utf8_decode(
+	wchar_t *result,
+	struct libadt_const_lptr string
+);
 ssize_t _descent_xml_lex_mbrtowc(
 	wchar_t *result,
 	struct libadt_const_lptr string,
 	mbstate_t *_mbstate
 );
+ssize_t _descent_xml_lex_decode(
+	wchar_t *result,
+	struct libadt_const_lptr string
+);
 bool _descent_xml_lex_read_error(_descent_xml_lex_read_t read);
 _descent_xml_lex_read_t _descent_xml_lex_read(
 	struct libadt_const_lptr script,
 	descent_xml_classifier_fn *const previous
 );
+ssize_t _descent_xml_lex_skip(
+	struct libadt_const_lptr script,
+	descent_xml_classifier_fn *const type
+);
 struct descent_xml_lex descent_xml_lex_init(
 	struct libadt_const_lptr script
 );
+struct descent_xml_lex _descent_xml_lex_next_markup(
+	struct descent_xml_lex token
+);
+struct descent_xml_lex descent_xml_lex_next_raw_fn(
+	struct descent_xml_lex token
+);
+struct descent_xml_lex descent_xml_lex_next_raw_table(
+	struct descent_xml_lex token
+);
 struct descent_xml_lex descent_xml_lex_next_raw(
 	struct descent_xml_lex previous
 );
+struct descent_xml_lex descent_xml_lex_next_batch(
+	struct descent_xml_lex token,
+	struct descent_xml_lex_batch *batch,
+	size_t capacity
+);
+struct descent_xml_lex descent_xml_lex_batch_get(
+	struct descent_xml_lex token,
+	struct descent_xml_lex_batch batch,
+	size_t index
+);
+struct descent_xml_lex_push descent_xml_lex_push_init(void);
+bool _descent_xml_lex_push_markup_ready(
+	struct libadt_const_lptr next,
+	size_t *scanned
+);
+bool _descent_xml_lex_push_can_grow(descent_xml_classifier_fn *type);
+struct descent_xml_lex _descent_xml_lex_push_need_input(
+	struct libadt_const_lptr script,
+	struct libadt_const_lptr next
+);
+struct descent_xml_lex _descent_xml_lex_push_complete(
+	struct descent_xml_lex_push *push,
+	struct descent_xml_lex token
+);
+struct descent_xml_lex descent_xml_lex_push_next(
+	struct descent_xml_lex_push *push,
+	struct libadt_const_lptr script,
+	bool final
+);
+void descent_xml_lex_push_discard(
+	struct descent_xml_lex_push *push,
+	size_t amount
+);
+struct descent_xml_lex_compact descent_xml_lex_to_compact(
+	struct descent_xml_lex token
+);
+struct descent_xml_lex descent_xml_lex_from_compact(
+	struct libadt_const_lptr script,
+	struct descent_xml_lex_compact compact
+);
 bool _descent_xml_lex_startswith(
 	struct libadt_const_lptr string,
 	struct libadt_const_lptr start
@@ -30,6 +92,7 @@ bool _descent_xml_lex_startswith(
 struct descent_xml_lex descent_xml_lex_handle_doctype(
 	struct descent_xml_lex token
 );
+bool _descent_xml_lex_iswspace(wchar_t c);
 ssize_t _descent_xml_lex_count_spaces(
 	struct libadt_const_lptr next
 );
@@ -127,3 +190,48 @@ vfn *descent_xml_lex_comment(wchar_t input)
 	return descent_xml_lex_doctype(input);
 }
 
+vfn *descent_xml_lex_need_input(wchar_t input)
+{
+	(void)input;
+	return (vfn*)descent_xml_classifier_unexpected;
+}
+
+_Static_assert(
+	DESCENT_XML_LEX_TYPE_COUNT <= UINT8_MAX + 1,
+	"token types must fit in descent_xml_lex_compact.type"
+);
+
+#define T(name) (DESCENT_XML_LEX_##name - DESCENT_XML_CLASSIFIER_STATE_COUNT)
+
+static descent_xml_classifier_fn *const lex_type_fns[] = {
+	[T(DOCTYPE)] = descent_xml_lex_doctype,
+	[T(XMLDECL)] = descent_xml_lex_xmldecl,
+	[T(CDATA)] = descent_xml_lex_cdata,
+	[T(COMMENT)] = descent_xml_lex_comment,
+	[T(NEED_INPUT)] = descent_xml_lex_need_input,
+};
+
+#undef T
+
+unsigned char descent_xml_lex_type_id(descent_xml_classifier_fn *type)
+{
+	const enum descent_xml_classifier_state state
+		= descent_xml_classifier_fn_state(type);
+	if (state != DESCENT_XML_CLASSIFIER_STATE_COUNT)
+		return (unsigned char)state;
+
+	const int count = DESCENT_XML_LEX_TYPE_COUNT - DESCENT_XML_CLASSIFIER_STATE_COUNT;
+	for (int i = 0; i < count; i++)
+		if (lex_type_fns[i] == type)
+			return (unsigned char)(DESCENT_XML_CLASSIFIER_STATE_COUNT + i);
+	return DESCENT_XML_CLASSIFIER_UNEXPECTED;
+}
+
+descent_xml_classifier_fn *descent_xml_lex_type_fn(unsigned char id)
+{
+	if (id < DESCENT_XML_CLASSIFIER_STATE_COUNT)
+		return descent_xml_classifier_state_fn(id);
+	if (id < DESCENT_XML_LEX_TYPE_COUNT)
+		return lex_type_fns[id - DESCENT_XML_CLASSIFIER_STATE_COUNT];
+	return descent_xml_classifier_unexpected;
+}
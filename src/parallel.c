@@ -0,0 +1,576 @@
+#include "descent-xml/parallel.h"
+
+#include "descent-xml/validate.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct libadt_const_lptr lptr_t;
+typedef struct descent_xml_lex token_t;
+
+// The things a chunk can't judge on its own, because they're
+// only valid at certain places in the document
+enum event {
+	EVENT_LT,
+	EVENT_XMLDECL,
+	EVENT_DOCTYPE,
+	EVENT_COMMENT,
+	EVENT_CDATA,
+	EVENT_CLOSE_TAG,
+	EVENT_OPEN,
+	EVENT_DONE,
+	EVENT_TEXT,
+	EVENT_EOF,
+};
+
+enum stage {
+	STAGE_PROLOG,
+	STAGE_ROOT,
+	STAGE_EPILOG,
+	STAGE_FAILED,
+};
+
+// Where we are in the document, when no elements are open
+typedef struct {
+	unsigned char stage;
+	bool markup;
+	bool doctype;
+} level_t;
+
+// The levels a run can start at: the four prolog
+// combinations of markup and doctype, then the epilog
+#define LEVEL_COUNT 5
+
+static level_t level_from_index(int index)
+{
+	if (index == 4)
+		return (level_t) { .stage = STAGE_EPILOG };
+	return (level_t) {
+		.stage = STAGE_PROLOG,
+		.markup = index & 1,
+		.doctype = index & 2,
+	};
+}
+
+static int level_index(level_t level)
+{
+	if (level.stage == STAGE_EPILOG)
+		return 4;
+	return level.markup | (level.doctype << 1);
+}
+
+// Mirrors descent_xml_validate_step() for events that
+// happen while no elements are open
+static void level_step(level_t *level, enum event event)
+{
+	if (level->stage == STAGE_FAILED)
+		return;
+
+	bool valid = true;
+	switch (event) {
+		case EVENT_LT:
+			valid = level->stage != STAGE_EPILOG;
+			break;
+		case EVENT_XMLDECL:
+			valid = level->stage == STAGE_PROLOG && !level->markup;
+			level->markup = true;
+			break;
+		case EVENT_DOCTYPE:
+			valid = level->stage == STAGE_PROLOG && !level->doctype;
+			level->doctype = level->markup = true;
+			break;
+		case EVENT_COMMENT:
+			valid = level->stage != STAGE_EPILOG;
+			level->markup = true;
+			break;
+		case EVENT_CDATA:
+		case EVENT_CLOSE_TAG:
+			valid = level->stage == STAGE_ROOT;
+			level->markup = true;
+			break;
+		case EVENT_OPEN:
+			valid = level->stage != STAGE_EPILOG;
+			level->stage = STAGE_ROOT;
+			level->markup = true;
+			break;
+		case EVENT_DONE:
+			level->stage = STAGE_EPILOG;
+			break;
+		case EVENT_TEXT:
+			valid = level->stage == STAGE_ROOT;
+			break;
+		case EVENT_EOF:
+			valid = level->stage == STAGE_EPILOG;
+			break;
+	}
+	if (!valid)
+		level->stage = STAGE_FAILED;
+}
+
+// The events between two end tags a chunk couldn't match.
+// Whether they're valid depends on whether the run starts
+// inside an element, and if not, where in the document it is,
+// so every possibility is worked out as the chunk is lexed.
+typedef struct {
+	level_t outcomes[LEVEL_COUNT];
+	bool nested_fail;
+	bool eof;
+	size_t depth;
+	lptr_t close;
+} run_t;
+
+typedef struct {
+	run_t *runs;
+	size_t runs_length;
+	size_t runs_capacity;
+
+	// Elements opened in the chunk, and not yet closed
+	lptr_t *opens;
+	size_t opens_length;
+	size_t opens_capacity;
+
+	// The '<' token the chunk stopped before, if stopped
+	token_t stop;
+	bool stopped;
+	bool failed;
+
+	size_t max_depth;
+} summary_t;
+
+static bool grow(void *buffer_p, size_t *capacity, size_t length, size_t size)
+{
+	void **const buffer = buffer_p;
+	if (length < *capacity)
+		return true;
+
+	const size_t new_capacity = *capacity ? *capacity * 2 : 16;
+	void *const result = realloc(*buffer, new_capacity * size);
+	if (!result)
+		return false;
+	*buffer = result;
+	*capacity = new_capacity;
+	return true;
+}
+
+static bool fail(summary_t *summary)
+{
+	summary->failed = true;
+	return false;
+}
+
+static bool new_run(summary_t *summary)
+{
+	// A chunk can't close more elements than can be open
+	if (summary->runs_length > summary->max_depth)
+		return fail(summary);
+
+	const bool room = grow(
+		&summary->runs,
+		&summary->runs_capacity,
+		summary->runs_length,
+		sizeof(run_t)
+	);
+	if (!room)
+		return fail(summary);
+
+	run_t *const run = &summary->runs[summary->runs_length++];
+	*run = (run_t) { 0 };
+	for (int i = 0; i < LEVEL_COUNT; i++)
+		run->outcomes[i] = level_from_index(i);
+	return true;
+}
+
+static void emit(summary_t *summary, enum event event)
+{
+	run_t *const run = &summary->runs[summary->runs_length - 1];
+	for (int i = 0; i < LEVEL_COUNT; i++)
+		level_step(&run->outcomes[i], event);
+
+	if (event == EVENT_XMLDECL || event == EVENT_DOCTYPE)
+		run->nested_fail = true;
+	if (event == EVENT_EOF)
+		run->eof = true;
+}
+
+static bool open_element(summary_t *summary, lptr_t name)
+{
+	if (summary->opens_length >= summary->max_depth)
+		return fail(summary);
+
+	const bool room = grow(
+		&summary->opens,
+		&summary->opens_capacity,
+		summary->opens_length,
+		sizeof(lptr_t)
+	);
+	if (!room)
+		return fail(summary);
+
+	summary->opens[summary->opens_length++] = name;
+
+	run_t *const run = &summary->runs[summary->runs_length - 1];
+	if (summary->opens_length > run->depth)
+		run->depth = summary->opens_length;
+	return true;
+}
+
+static void close_element(summary_t *summary)
+{
+	summary->opens_length--;
+	if (!summary->opens_length)
+		emit(summary, EVENT_DONE);
+}
+
+// Mirrors descent_xml_validate_step(), leaving anything that
+// depends on elements opened before the chunk to the merge
+static bool process(summary_t *summary, token_t token, bool *markup)
+{
+	const bool top = !summary->opens_length;
+
+	if (*markup) {
+		*markup = false;
+
+		if (token.type == descent_xml_lex_xmldecl) {
+			if (!top)
+				return fail(summary);
+			emit(summary, EVENT_XMLDECL);
+		} else if (token.type == descent_xml_lex_doctype) {
+			if (!top)
+				return fail(summary);
+			emit(summary, EVENT_DOCTYPE);
+		} else if (token.type == descent_xml_lex_comment) {
+			if (top)
+				emit(summary, EVENT_COMMENT);
+		} else if (token.type == descent_xml_lex_cdata) {
+			if (top)
+				emit(summary, EVENT_CDATA);
+		} else if (token.type == descent_xml_classifier_element_close) {
+			if (top)
+				emit(summary, EVENT_CLOSE_TAG);
+		} else if (token.type == descent_xml_classifier_element_name) {
+			if (libadt_const_lptr_equal(token.value, libadt_str_literal("?xml")))
+				return fail(summary);
+			if (top)
+				emit(summary, EVENT_OPEN);
+			return open_element(summary, token.value);
+		} else {
+			return fail(summary);
+		}
+		return true;
+	}
+
+	if (token.type == descent_xml_classifier_eof) {
+		if (!top)
+			return fail(summary);
+		emit(summary, EVENT_EOF);
+		return false;
+	} else if (token.type == descent_xml_classifier_unexpected) {
+		return fail(summary);
+	} else if (token.type == descent_xml_classifier_element) {
+		if (top)
+			emit(summary, EVENT_LT);
+		*markup = true;
+	} else if (token.type == descent_xml_classifier_element_empty) {
+		close_element(summary);
+	} else if (token.type == descent_xml_classifier_element_close_name) {
+		if (top) {
+			summary->runs[summary->runs_length - 1].close = token.value;
+			return new_run(summary);
+		}
+		const bool match = libadt_const_lptr_equal(
+			token.value,
+			summary->opens[summary->opens_length - 1]
+		);
+		if (!match)
+			return fail(summary);
+		close_element(summary);
+	} else if (_descent_xml_non_space_text(token)) {
+		if (top)
+			emit(summary, EVENT_TEXT);
+	}
+
+	return true;
+}
+
+static size_t offset_of(token_t token)
+{
+	return (size_t)(
+		(const char *)token.value.buffer
+		- (const char *)token.script.buffer
+	);
+}
+
+// Lexes from token, which must be the first token of the
+// chunk, until the first '<' at or after end
+static void summarize(summary_t *summary, token_t token, size_t end)
+{
+	bool markup = false;
+
+	if (!new_run(summary))
+		return;
+
+	for (;; token = descent_xml_lex_next_raw(token)) {
+		const bool boundary = token.type == descent_xml_classifier_element
+			&& offset_of(token) >= end;
+		if (boundary) {
+			summary->stop = token;
+			summary->stopped = true;
+			return;
+		}
+
+		if (!process(summary, token, &markup))
+			return;
+	}
+}
+
+static void summary_free(summary_t *summary)
+{
+	free(summary->runs);
+	free(summary->opens);
+}
+
+typedef struct {
+	level_t level;
+	lptr_t *names;
+	size_t names_length;
+	size_t names_capacity;
+	size_t max_depth;
+	bool done;
+} merge_t;
+
+// Applies a chunk's summary to the document's state,
+// returning false if the document is invalid
+static bool merge(merge_t *state, const summary_t *summary)
+{
+	if (summary->failed)
+		return false;
+
+	for (size_t i = 0; i < summary->runs_length; i++) {
+		const run_t *const run = &summary->runs[i];
+
+		if (state->names_length) {
+			if (run->nested_fail || run->eof)
+				return false;
+		} else {
+			state->level = run->outcomes[level_index(state->level)];
+			if (state->level.stage == STAGE_FAILED)
+				return false;
+		}
+
+		if (state->names_length + run->depth > state->max_depth)
+			return false;
+
+		if (run->eof) {
+			state->done = true;
+			return true;
+		}
+
+		if (i + 1 == summary->runs_length)
+			break;
+
+		// every run but the last ends with an end tag for
+		// something opened before the chunk
+		if (!state->names_length)
+			return false;
+		const bool match = libadt_const_lptr_equal(
+			run->close,
+			state->names[--state->names_length]
+		);
+		if (!match)
+			return false;
+		if (!state->names_length)
+			state->level.stage = STAGE_EPILOG;
+	}
+
+	for (size_t i = 0; i < summary->opens_length; i++) {
+		const bool room = grow(
+			&state->names,
+			&state->names_capacity,
+			state->names_length,
+			sizeof(lptr_t)
+		);
+		if (!room)
+			return false;
+		state->names[state->names_length++] = summary->opens[i];
+	}
+	return true;
+}
+
+typedef struct {
+	token_t script;
+	const size_t *starts;
+	summary_t *summaries;
+	size_t count;
+	atomic_size_t next;
+} jobs_t;
+
+static token_t chunk_token(token_t token, size_t start)
+{
+	if (!start)
+		return descent_xml_lex_next_raw(token);
+
+	// anything that a '<' always follows will do
+	const token_t previous = {
+		.type = descent_xml_classifier_element_end,
+		.script = token.script,
+		.value = libadt_const_lptr_truncate(
+			libadt_const_lptr_index(token.script, (ssize_t)start),
+			0
+		),
+	};
+	return descent_xml_lex_next_raw(previous);
+}
+
+static void *worker(void *jobs_p)
+{
+	jobs_t *const jobs = jobs_p;
+	for (;;) {
+		const size_t i = atomic_fetch_add(&jobs->next, 1);
+		if (i >= jobs->count)
+			return NULL;
+
+		summarize(
+			&jobs->summaries[i],
+			chunk_token(jobs->script, jobs->starts[i]),
+			jobs->starts[i + 1]
+		);
+	}
+}
+
+// Splits the script into chunks of about chunk bytes, each
+// starting at a '<'. Returns the number of chunks, with
+// starts[count] set to SIZE_MAX.
+static size_t split(lptr_t script, size_t chunk, size_t *starts)
+{
+	const char *const buffer = script.buffer;
+	const size_t length = (size_t)script.length;
+	size_t count = 1;
+	starts[0] = 0;
+
+	for (size_t position = chunk; position < length; position += chunk) {
+		const char *const found = memchr(
+			buffer + position,
+			'<',
+			length - position
+		);
+		if (!found)
+			break;
+		position = (size_t)(found - buffer);
+		starts[count++] = position;
+	}
+
+	starts[count] = SIZE_MAX;
+	return count;
+}
+
+static bool validate(jobs_t *jobs, size_t max_depth)
+{
+	merge_t state = {
+		.level = { .stage = STAGE_PROLOG },
+		.max_depth = max_depth,
+	};
+	const summary_t *current = &jobs->summaries[0];
+	summary_t retry = { 0 };
+	bool valid = true;
+	size_t next = 1;
+
+	for (;;) {
+		valid = merge(&state, current);
+		if (!valid || state.done || !current->stopped)
+			break;
+
+		// find the chunk the lexer really got to
+		const size_t stop = offset_of(current->stop);
+		while (jobs->starts[next] < stop)
+			next++;
+
+		if (jobs->starts[next] == stop) {
+			current = &jobs->summaries[next++];
+			continue;
+		}
+
+		// it started inside a comment or CDATA section,
+		// so lex again from where the last chunk stopped
+		const token_t from = current->stop;
+		summary_free(&retry);
+		retry = (summary_t) { .max_depth = max_depth };
+		summarize(&retry, from, jobs->starts[next]);
+		current = &retry;
+	}
+
+	valid = valid && state.done;
+	summary_free(&retry);
+	free(state.names);
+	return valid;
+}
+
+bool descent_xml_parallel_validate_depth(
+	struct descent_xml_lex token,
+	int depth,
+	int workers,
+	size_t chunk
+)
+{
+	if (!chunk)
+		chunk = DESCENT_XML_PARALLEL_CHUNK;
+	if (workers < 1)
+		workers = 1;
+	const size_t max_depth = depth < 0 ? SIZE_MAX : (size_t)depth;
+
+	const size_t length = token.script.length > 0
+		? (size_t)token.script.length
+		: 0;
+	size_t *const starts = malloc((length / chunk + 2) * sizeof(size_t));
+	if (!starts)
+		return false;
+
+	jobs_t jobs = {
+		.script = token,
+		.starts = starts,
+		.count = split(token.script, chunk, starts),
+	};
+	jobs.summaries = calloc(jobs.count, sizeof(summary_t));
+	if (!jobs.summaries) {
+		free(starts);
+		return false;
+	}
+	for (size_t i = 0; i < jobs.count; i++)
+		jobs.summaries[i].max_depth = max_depth;
+
+	const size_t extra = (size_t)workers - 1 < jobs.count - 1
+		? (size_t)workers - 1
+		: jobs.count - 1;
+	pthread_t *const threads = extra
+		? calloc(extra, sizeof(pthread_t))
+		: NULL;
+	size_t started = 0;
+	if (threads)
+		for (; started < extra; started++)
+			if (pthread_create(&threads[started], NULL, worker, &jobs))
+				break;
+
+	worker(&jobs);
+
+	for (size_t i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+	const bool valid = validate(&jobs, max_depth);
+
+	for (size_t i = 0; i < jobs.count; i++)
+		summary_free(&jobs.summaries[i]);
+	free(jobs.summaries);
+	free(starts);
+	return valid;
+}
+
+bool descent_xml_parallel_validate(
+	struct descent_xml_lex token,
+	int workers
+)
+{
+	return descent_xml_parallel_validate_depth(token, 1000, workers, 0);
+}
@@ -9,12 +9,30 @@ descent_xml_classifier_void_fn *descent_xml_parse_error(wchar_t c)
 	return (descent_xml_classifier_void_fn *)descent_xml_parse_error;
 }
 
+_Thread_local struct descent_xml_parse_context _descent_xml_parse_cstr_buffers;
+
 bool _descent_xml_end_token(struct descent_xml_lex token);
+struct descent_xml_parse_context descent_xml_parse_context_init(void);
+void descent_xml_parse_context_free(
+	struct descent_xml_parse_context *parse
+);
+bool _descent_xml_attribute_spans_append(
+	_descent_xml_attribute_spans_t *attributes,
+	struct libadt_const_lptr span
+);
 struct descent_xml_lex _descent_xml_handle_element(
+	struct descent_xml_parse_context *parse,
 	struct descent_xml_lex token,
 	descent_xml_parse_element_fn *element_handler,
 	void *context
 );
+struct descent_xml_lex descent_xml_parse_with(
+	struct descent_xml_parse_context *parse,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_fn *element_handler,
+	descent_xml_parse_text_fn *text_handler,
+	void *context
+);
 struct descent_xml_lex descent_xml_parse(
 	struct descent_xml_lex xml,
 	descent_xml_parse_element_fn *element_handler,
@@ -46,9 +64,79 @@ void _cstr_text_handler(
 	bool is_cdata,
 	void *context
 );
+struct descent_xml_lex descent_xml_parse_cstr_with(
+	struct descent_xml_parse_context *parse,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_cstr_fn *element_handler,
+	descent_xml_parse_text_cstr_fn *text_handler,
+	void *context
+);
 struct descent_xml_lex descent_xml_parse_cstr(
 	struct descent_xml_lex xml,
 	descent_xml_parse_element_cstr_fn *element_handler,
 	descent_xml_parse_text_cstr_fn *text_handler,
 	void *context
 );
+void descent_xml_parse_cstr_release(void);
+char *_descent_xml_insitu_terminate(
+	struct libadt_const_lptr span,
+	char *saved
+);
+void _descent_xml_insitu_restore(
+	struct libadt_const_lptr span,
+	char saved
+);
+struct descent_xml_lex _insitu_element_handler(
+	struct descent_xml_lex xml,
+	struct libadt_const_lptr element_name,
+	struct libadt_const_lptr attributes,
+	bool empty,
+	void *context
+);
+void _insitu_text_handler(
+	struct libadt_const_lptr text,
+	bool is_cdata,
+	void *context
+);
+struct descent_xml_lex descent_xml_parse_insitu_with(
+	struct descent_xml_parse_context *parse,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_cstr_fn *element_handler,
+	descent_xml_parse_text_cstr_fn *text_handler,
+	void *context
+);
+struct descent_xml_lex descent_xml_parse_insitu(
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_cstr_fn *element_handler,
+	descent_xml_parse_text_cstr_fn *text_handler,
+	void *context
+);
+bool _descent_xml_parse_events_append(
+	_descent_xml_parse_events_context *events,
+	struct libadt_const_lptr value,
+	enum descent_xml_parse_segment_type type
+);
+bool _descent_xml_parse_events_segment(
+	_descent_xml_parse_events_context *events,
+	struct descent_xml_lex token
+);
+struct descent_xml_lex _descent_xml_parse_events_start(
+	struct descent_xml_lex token,
+	struct libadt_const_lptr element_name,
+	struct libadt_const_lptr attributes,
+	bool empty,
+	void *context
+);
+struct descent_xml_lex descent_xml_parse_events(
+	struct descent_xml_lex xml,
+	const struct descent_xml_parse_handlers *handlers
+);
+bool _descent_xml_parse_events_id(
+	const struct descent_xml_parse_handlers *handlers,
+	struct libadt_const_lptr name,
+	ssize_t *id
+);
+bool _descent_xml_parse_events_intern(
+	_descent_xml_parse_events_context *events,
+	struct descent_xml_parse_element *element
+);
@@ -0,0 +1,279 @@
+#include "descent-xml/scan.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Bytes that stop a scan. Kernels that need fewer than
+// the maximum just repeat one.
+#define STOP_COUNT 5
+
+typedef unsigned char stops_t[STOP_COUNT];
+
+static bool is_stop(unsigned char byte, const stops_t stops)
+{
+	if (byte >= 0x80)
+		return true;
+	for (int i = 0; i < STOP_COUNT; i++)
+		if (byte == stops[i])
+			return true;
+	return false;
+}
+
+// Returns the index of the first byte in bytes that's
+// either in stops, or not ASCII.
+static ssize_t scan_until(
+	const unsigned char *bytes,
+	ssize_t length,
+	const stops_t stops
+)
+{
+	ssize_t i = 0;
+
+#if defined(__AVX2__)
+	{
+		__m256i wide[STOP_COUNT];
+		for (int j = 0; j < STOP_COUNT; j++)
+			wide[j] = _mm256_set1_epi8((char)stops[j]);
+
+		for (; i + 32 <= length; i += 32) {
+			const __m256i chunk
+				= _mm256_loadu_si256((const __m256i *)&bytes[i]);
+
+			// non-ASCII bytes already have their high bit set
+			__m256i hits = chunk;
+			for (int j = 0; j < STOP_COUNT; j++)
+				hits = _mm256_or_si256(
+					hits,
+					_mm256_cmpeq_epi8(chunk, wide[j])
+				);
+
+			const uint32_t mask
+				= (uint32_t)_mm256_movemask_epi8(hits);
+			if (mask)
+				return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+#if defined(__SSE2__)
+	{
+		__m128i wide[STOP_COUNT];
+		for (int j = 0; j < STOP_COUNT; j++)
+			wide[j] = _mm_set1_epi8((char)stops[j]);
+
+		for (; i + 16 <= length; i += 16) {
+			const __m128i chunk
+				= _mm_loadu_si128((const __m128i *)&bytes[i]);
+
+			__m128i hits = chunk;
+			for (int j = 0; j < STOP_COUNT; j++)
+				hits = _mm_or_si128(
+					hits,
+					_mm_cmpeq_epi8(chunk, wide[j])
+				);
+
+			const uint32_t mask
+				= (uint32_t)_mm_movemask_epi8(hits);
+			if (mask)
+				return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	for (; i < length; i++)
+		if (is_stop(bytes[i], stops))
+			return i;
+	return length;
+}
+
+static bool is_space(unsigned char byte)
+{
+	return byte == ' '
+		|| byte == '\t'
+		|| byte == '\r'
+		|| byte == '\n';
+}
+
+ssize_t descent_xml_scan_text(struct libadt_const_lptr string)
+{
+	static const stops_t stops = { '<', '&', '%', '\0', '\0' };
+	if (string.length <= 0)
+		return 0;
+	return scan_until(string.buffer, string.length, stops);
+}
+
+ssize_t descent_xml_scan_attribute_value(
+	struct libadt_const_lptr string,
+	char quote
+)
+{
+	const stops_t stops = {
+		(unsigned char)quote,
+		'<',
+		'&',
+		'%',
+		'\0',
+	};
+	if (string.length <= 0)
+		return 0;
+	return scan_until(string.buffer, string.length, stops);
+}
+
+ssize_t descent_xml_scan_space(struct libadt_const_lptr string)
+{
+	const unsigned char *const bytes = string.buffer;
+	const ssize_t length = string.length;
+	ssize_t i = 0;
+
+	if (length <= 0)
+		return 0;
+
+#if defined(__AVX2__)
+	{
+		const __m256i space = _mm256_set1_epi8(' ');
+		const __m256i tab = _mm256_set1_epi8('\t');
+		const __m256i cr = _mm256_set1_epi8('\r');
+		const __m256i lf = _mm256_set1_epi8('\n');
+
+		for (; i + 32 <= length; i += 32) {
+			const __m256i chunk
+				= _mm256_loadu_si256((const __m256i *)&bytes[i]);
+			const __m256i spaces = _mm256_or_si256(
+				_mm256_or_si256(
+					_mm256_cmpeq_epi8(chunk, space),
+					_mm256_cmpeq_epi8(chunk, tab)
+				),
+				_mm256_or_si256(
+					_mm256_cmpeq_epi8(chunk, cr),
+					_mm256_cmpeq_epi8(chunk, lf)
+				)
+			);
+
+			const uint32_t mask
+				= ~(uint32_t)_mm256_movemask_epi8(spaces);
+			if (mask)
+				return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+#if defined(__SSE2__)
+	{
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i tab = _mm_set1_epi8('\t');
+		const __m128i cr = _mm_set1_epi8('\r');
+		const __m128i lf = _mm_set1_epi8('\n');
+
+		for (; i + 16 <= length; i += 16) {
+			const __m128i chunk
+				= _mm_loadu_si128((const __m128i *)&bytes[i]);
+			const __m128i spaces = _mm_or_si128(
+				_mm_or_si128(
+					_mm_cmpeq_epi8(chunk, space),
+					_mm_cmpeq_epi8(chunk, tab)
+				),
+				_mm_or_si128(
+					_mm_cmpeq_epi8(chunk, cr),
+					_mm_cmpeq_epi8(chunk, lf)
+				)
+			);
+
+			const uint32_t mask
+				= ~(uint32_t)_mm_movemask_epi8(spaces) & 0xFFFF;
+			if (mask)
+				return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	for (; i < length; i++)
+		if (!is_space(bytes[i]))
+			return i;
+	return length;
+}
+
+ssize_t descent_xml_scan_pair(
+	struct libadt_const_lptr string,
+	char first,
+	char second
+)
+{
+	const unsigned char *const bytes = string.buffer;
+	const ssize_t length = string.length;
+	ssize_t i = 0;
+
+	if (length < 2)
+		return -1;
+
+	// Compare each block against first, and the same block
+	// shifted along by one against second: a match is where
+	// both line up.
+#if defined(__AVX2__)
+	{
+		const __m256i wide_first = _mm256_set1_epi8(first);
+		const __m256i wide_second = _mm256_set1_epi8(second);
+
+		for (; i + 33 <= length; i += 32) {
+			const __m256i here
+				= _mm256_loadu_si256((const __m256i *)&bytes[i]);
+			const __m256i next
+				= _mm256_loadu_si256((const __m256i *)&bytes[i + 1]);
+			const __m256i matches = _mm256_and_si256(
+				_mm256_cmpeq_epi8(here, wide_first),
+				_mm256_cmpeq_epi8(next, wide_second)
+			);
+
+			const uint32_t mask
+				= (uint32_t)_mm256_movemask_epi8(matches);
+			if (mask)
+				return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+#if defined(__SSE2__)
+	{
+		const __m128i wide_first = _mm_set1_epi8(first);
+		const __m128i wide_second = _mm_set1_epi8(second);
+
+		for (; i + 17 <= length; i += 16) {
+			const __m128i here
+				= _mm_loadu_si128((const __m128i *)&bytes[i]);
+			const __m128i next
+				= _mm_loadu_si128((const __m128i *)&bytes[i + 1]);
+			const __m128i matches = _mm_and_si128(
+				_mm_cmpeq_epi8(here, wide_first),
+				_mm_cmpeq_epi8(next, wide_second)
+			);
+
+			const uint32_t mask
+				= (uint32_t)_mm_movemask_epi8(matches);
+			if (mask)
+				return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	while (i + 1 < length) {
+		const unsigned char *const found = memchr(
+			&bytes[i],
+			(unsigned char)first,
+			(size_t)(length - i - 1)
+		);
+		if (!found)
+			return -1;
+
+		i = found - bytes;
+		if (bytes[i + 1] == (unsigned char)second)
+			return i;
+		i++;
+	}
+	return -1;
+}
@@ -0,0 +1,137 @@
+#include "descent-xml/stream.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int descent_xml_stream_init(
+	struct descent_xml_stream *stream,
+	int fd,
+	size_t window
+)
+{
+	if (!window)
+		window = DESCENT_XML_STREAM_WINDOW;
+
+	*stream = (struct descent_xml_stream) {
+		.fd = fd,
+		.push = descent_xml_lex_push_init(),
+		._buffer = malloc(window),
+		._capacity = window,
+	};
+	return stream->_buffer ? 0 : -1;
+}
+
+void descent_xml_stream_free(struct descent_xml_stream *stream)
+{
+	free(stream->_buffer);
+	stream->_buffer = NULL;
+	stream->_length = stream->_capacity = 0;
+}
+
+static struct libadt_const_lptr window(const struct descent_xml_stream *stream)
+{
+	return (struct libadt_const_lptr) {
+		.buffer = stream->_buffer,
+		.size = sizeof(char),
+		.length = (ssize_t)stream->_length,
+	};
+}
+
+static struct descent_xml_lex read_error(
+	struct descent_xml_stream *stream,
+	int error
+)
+{
+	stream->error = error;
+	return (struct descent_xml_lex) {
+		.type = descent_xml_classifier_unexpected,
+		.script = window(stream),
+		.value = libadt_const_lptr_truncate(window(stream), 0),
+	};
+}
+
+// Drops everything before the last token, then
+// tops the window up from the file
+static int fill(struct descent_xml_stream *stream)
+{
+	const size_t keep = stream->push.offset;
+	memmove(
+		stream->_buffer,
+		stream->_buffer + keep,
+		stream->_length - keep
+	);
+	stream->_length -= keep;
+	descent_xml_lex_push_discard(&stream->push, keep);
+
+	if (stream->_length == stream->_capacity) {
+		const size_t capacity = stream->_capacity * 2;
+		char *const buffer = realloc(stream->_buffer, capacity);
+		if (!buffer)
+			return ENOMEM;
+		stream->_buffer = buffer;
+		stream->_capacity = capacity;
+	}
+
+	for (;;) {
+		const ssize_t amount = read(
+			stream->fd,
+			stream->_buffer + stream->_length,
+			stream->_capacity - stream->_length
+		);
+		if (amount < 0 && errno == EINTR)
+			continue;
+		if (amount < 0)
+			return errno;
+
+		stream->_length += (size_t)amount;
+		stream->eof = amount == 0;
+		return 0;
+	}
+}
+
+struct descent_xml_lex descent_xml_stream_next(
+	struct descent_xml_stream *stream
+)
+{
+	if (stream->error)
+		return read_error(stream, stream->error);
+
+	for (;;) {
+		const struct descent_xml_lex token = descent_xml_lex_push_next(
+			&stream->push,
+			window(stream),
+			stream->eof
+		);
+		if (token.type != descent_xml_lex_need_input)
+			return token;
+
+		const int error = fill(stream);
+		if (error)
+			return read_error(stream, error);
+	}
+}
+
+bool descent_xml_stream_validate_depth(
+	struct descent_xml_stream *stream,
+	int depth
+)
+{
+	struct descent_xml_validate_state state
+		= descent_xml_validate_state_init(depth);
+
+	while (
+		descent_xml_validate_step(&state, descent_xml_stream_next(stream))
+		&& !state.done
+	);
+
+	const bool valid = state.valid;
+	descent_xml_validate_state_free(&state);
+	return valid;
+}
+
+bool descent_xml_stream_validate(struct descent_xml_stream *stream)
+{
+	return descent_xml_stream_validate_depth(stream, 1000);
+}
@@ -1,24 +1,45 @@
 #include "descent-xml/validate.h"
 
-struct descent_xml_lex _descent_xml_validate_element_handler(
-	struct descent_xml_lex token,
-	struct libadt_const_lptr element_name,
-	struct libadt_const_lptr attributes,
-	bool empty,
-	void *context
+#include <stdlib.h>
+
+descent_xml_classifier_void_fn *descent_xml_validate_error(wchar_t c)
+{
+	(void)c;
+	abort();
+	return (descent_xml_classifier_void_fn *)descent_xml_validate_error;
+}
+
+bool _descent_xml_non_space_text(struct descent_xml_lex token);
+struct descent_xml_validate_state descent_xml_validate_state_init(
+	int depth
 );
-bool descent_xml_validate_element_depth(struct descent_xml_lex token, int depth);
-bool descent_xml_validate_element(struct descent_xml_lex token);
-struct descent_xml_lex _descent_xml_validate_prolog_goto_element(
-	struct descent_xml_lex token
+void descent_xml_validate_state_free(
+	struct descent_xml_validate_state *state
+);
+bool _descent_xml_validate_push_span(
+	struct descent_xml_validate_state *state,
+	struct libadt_const_lptr name
+);
+bool _descent_xml_validate_push_name(
+	struct descent_xml_validate_state *state,
+	struct libadt_const_lptr name
+);
+struct libadt_const_lptr _descent_xml_validate_top_name(
+	const struct descent_xml_validate_state *state
 );
-struct descent_xml_lex _descent_xml_validate_prolog_comments(
+void _descent_xml_validate_pop_name(
+	struct descent_xml_validate_state *state
+);
+bool _descent_xml_validate_step_markup(
+	struct descent_xml_validate_state *state,
 	struct descent_xml_lex token
 );
-struct descent_xml_lex _descent_xml_validate_xmldecl(
+bool descent_xml_validate_step(
+	struct descent_xml_validate_state *state,
 	struct descent_xml_lex token
 );
-struct descent_xml_lex _descent_xml_validate_doctype(
+void _descent_xml_validate_run(
+	struct descent_xml_validate_state *state,
 	struct descent_xml_lex token
 );
 bool descent_xml_validate_document_depth(
@@ -26,7 +47,59 @@ bool descent_xml_validate_document_depth(
 	int depth
 );
 bool descent_xml_validate_document(struct descent_xml_lex token);
-bool _descent_xml_non_space_text(struct descent_xml_lex token);
-struct descent_xml_lex _descent_xml_validate_parse_prolog(
+bool descent_xml_validate_element_depth(struct descent_xml_lex token, int depth);
+bool descent_xml_validate_element(struct descent_xml_lex token);
+struct descent_xml_lex _descent_xml_validate_fail(
+	struct descent_xml_validate_state *state,
 	struct descent_xml_lex token
 );
+const char *_descent_xml_validate_end(struct descent_xml_lex token);
+bool _descent_xml_validate_record(
+	struct descent_xml_validate_state *state,
+	struct descent_xml_lex token
+);
+bool _descent_xml_validate_catch_up(
+	struct descent_xml_validate_state *state,
+	struct descent_xml_lex token
+);
+bool _descent_xml_validate_same(
+	struct descent_xml_lex a,
+	struct descent_xml_lex b
+);
+struct descent_xml_lex _descent_xml_validate_parse_element(
+	struct descent_xml_lex token,
+	struct libadt_const_lptr element_name,
+	struct libadt_const_lptr attributes,
+	bool empty,
+	void *context
+);
+struct descent_xml_lex descent_xml_validate_parse_with(
+	struct descent_xml_parse_context *parse,
+	struct descent_xml_validate_state *state,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_fn *element_handler,
+	descent_xml_parse_text_fn *text_handler,
+	void *context
+);
+struct descent_xml_lex descent_xml_validate_parse(
+	struct descent_xml_validate_state *state,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_fn *element_handler,
+	descent_xml_parse_text_fn *text_handler,
+	void *context
+);
+struct descent_xml_lex descent_xml_validate_parse_cstr_with(
+	struct descent_xml_parse_context *parse,
+	struct descent_xml_validate_state *state,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_cstr_fn *element_handler,
+	descent_xml_parse_text_cstr_fn *text_handler,
+	void *context
+);
+struct descent_xml_lex descent_xml_validate_parse_cstr(
+	struct descent_xml_validate_state *state,
+	struct descent_xml_lex xml,
+	descent_xml_parse_element_cstr_fn *element_handler,
+	descent_xml_parse_text_cstr_fn *text_handler,
+	void *context
+);
@@ -1,50 +1,205 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <locale.h>
 
 #include <descent-xml.h>
 
-typedef struct libadt_lptr ptr_t;
 typedef struct libadt_const_lptr cptr_t;
-#define cptr libadt_const_lptr
-#define allocated libadt_const_lptr_allocated
 
 typedef struct descent_xml_lex token_t;
 #define init descent_xml_lex_init
 #define valid descent_xml_validate_document
 
-ptr_t map_file(const char *const path)
+typedef struct descent_xml_stream stream_t;
+
+// What validating a file found: whether it's valid, or the errno
+// value if it couldn't be opened or read, which isn't the same as
+// being invalid
+typedef struct {
+	bool valid;
+	int error;
+} result_t;
+
+// Pipes, sockets, terminals and the like can't be mapped,
+// so they're read a window at a time instead
+result_t validate_stream(int fd)
 {
-	int fd = open(path, O_RDONLY);
-	if (fd < 0)
-		return (ptr_t) { 0 };
+	stream_t stream;
+	if (descent_xml_stream_init(&stream, fd, 0))
+		return (result_t) { .error = ENOMEM };
+
+	const result_t result = {
+		.valid = descent_xml_stream_validate(&stream),
+		.error = stream.error,
+	};
+	descent_xml_stream_free(&stream);
+	return result;
+}
+
+// Threads to validate each mapped file with
+long file_workers = 1;
 
-	size_t file_size = lseek(fd, 0, SEEK_END);
-	return (ptr_t) {
-		.buffer = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0),
+result_t validate_mapped(int fd, size_t size)
+{
+	void *const buffer = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (buffer == MAP_FAILED)
+		return validate_stream(fd);
+
+	const cptr_t script = {
+		.buffer = buffer,
 		.size = sizeof(char),
-		.length = file_size,
+		.length = (ssize_t)size,
+	};
+	token_t token = init(script);
+	const result_t result = {
+		.valid = file_workers > 1
+			? descent_xml_parallel_validate(token, (int)file_workers)
+			: valid(token),
 	};
+
+	munmap(buffer, size);
+	return result;
+}
+
+result_t validate_path(const char *const path)
+{
+	if (strcmp(path, "-") == 0)
+		return validate_stream(STDIN_FILENO);
+
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return (result_t) { .error = errno };
+
+	struct stat info;
+	result_t result;
+	if (fstat(fd, &info))
+		result = (result_t) { .error = errno };
+	else if (S_ISREG(info.st_mode) && info.st_size > 0)
+		result = validate_mapped(fd, (size_t)info.st_size);
+	else
+		result = validate_stream(fd);
+
+	close(fd);
+	return result;
+}
+
+typedef struct {
+	char **paths;
+	result_t *results;
+	size_t count;
+	atomic_size_t next;
+} jobs_t;
+
+void *worker(void *jobs_p)
+{
+	jobs_t *const jobs = jobs_p;
+	for (;;) {
+		const size_t i = atomic_fetch_add(&jobs->next, 1);
+		if (i >= jobs->count)
+			return NULL;
+		jobs->results[i] = validate_path(jobs->paths[i]);
+	}
+}
+
+// Validates every file, using up to workers threads. Files are
+// only ever read, and tokens are just pointers into them, so
+// there's nothing for the threads to share but the job counter.
+void validate_all(jobs_t *jobs, long workers)
+{
+	if (workers > (long)jobs->count)
+		workers = (long)jobs->count;
+
+	// this thread is one of the workers
+	const long extra = workers - 1;
+	pthread_t *const threads = extra > 0
+		? calloc((size_t)extra, sizeof(pthread_t))
+		: NULL;
+	long started = 0;
+	if (threads)
+		for (; started < extra; started++)
+			if (pthread_create(&threads[started], NULL, worker, jobs))
+				break;
+
+	worker(jobs);
+
+	for (long i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+}
+
+void usage(const char *const name)
+{
+	fprintf(stderr, "Usage: %s [-j jobs] [-p threads] file...\n", name);
+	fprintf(stderr, "Use - to read from standard input.\n");
+	fprintf(stderr, "-j validates several files at once.\n");
+	fprintf(stderr, "-p splits each file between several threads.\n");
+	fprintf(stderr, "0 uses one per online processor.\n");
+	fprintf(stderr, "Each file is reported as valid or invalid on standard output,\n");
+	fprintf(stderr, "or with the error that stopped it being read on standard error.\n");
 }
 
 int main(int argc, char **argv)
 {
+#ifdef DESCENT_XML_LOCALE_DECODER
 	setlocale(LC_ALL, "");
-	if (argc < 2)
+#endif
+	long workers = 1;
+	for (int option; (option = getopt(argc, argv, "j:p:")) != -1;) {
+		long *const count = option == 'j' ? &workers : &file_workers;
+		char *end = NULL;
+		switch (option) {
+			case 'j':
+			case 'p':
+				*count = strtol(optarg, &end, 10);
+				if (*optarg && !*end && *count >= 0)
+					break;
+				// fallthrough
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (workers == 0)
+		workers = sysconf(_SC_NPROCESSORS_ONLN);
+	if (file_workers == 0)
+		file_workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (optind >= argc) {
+		usage(argv[0]);
 		return EXIT_FAILURE;
+	}
 
-	argc--, argv++;
-	for (; *argv; argv++) {
-		ptr_t file = map_file(*argv);
-		cptr_t ptr = cptr(file);
+	jobs_t jobs = {
+		.paths = &argv[optind],
+		.count = (size_t)(argc - optind),
+	};
+	jobs.results = calloc(jobs.count, sizeof(result_t));
+	if (!jobs.results)
+		return EXIT_FAILURE;
 
-		if (!allocated(ptr))
-			return EXIT_FAILURE;
+	validate_all(&jobs, workers);
 
-		token_t token = init(ptr);
-		if (!valid(token))
-			return EXIT_FAILURE;
+	int result = EXIT_SUCCESS;
+	for (size_t i = 0; i < jobs.count; i++) {
+		const result_t file = jobs.results[i];
+		if (file.error) {
+			// so the two streams stay in file order on a terminal
+			fflush(stdout);
+			fprintf(stderr, "%s: %s\n", jobs.paths[i], strerror(file.error));
+		} else
+			printf("%s: %s\n", jobs.paths[i], file.valid ? "valid" : "invalid");
+		if (file.error || !file.valid)
+			result = EXIT_FAILURE;
 	}
+
+	free(jobs.results);
+	return result;
 }
@@ -0,0 +1,108 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include "descent-xml/arena.h"
+
+#include <libadt/str.h>
+
+typedef struct libadt_const_lptr lptr_t;
+
+#define lit libadt_str_literal
+
+void test_alloc(void)
+{
+	struct descent_xml_arena arena = descent_xml_arena_init();
+
+	char *const first = descent_xml_arena_strndup(&arena, lit("first"));
+	assert(first && strcmp(first, "first") == 0);
+
+	void *const aligned = descent_xml_arena_alloc(&arena, 3 * sizeof(double));
+	assert(aligned);
+	assert((uintptr_t)aligned % _Alignof(max_align_t) == 0);
+
+	char *const empty = descent_xml_arena_strndup(&arena, lit(""));
+	assert(empty && *empty == '\0');
+	assert(strcmp(first, "first") == 0);
+
+	descent_xml_arena_free(&arena);
+}
+
+void test_reset(void)
+{
+	struct descent_xml_arena arena = descent_xml_arena_init();
+	char *const kept = descent_xml_arena_strndup(&arena, lit("kept"));
+	const struct descent_xml_arena_mark mark = descent_xml_arena_mark(&arena);
+
+	char *const first = descent_xml_arena_strndup(&arena, lit("first"));
+	descent_xml_arena_reset(&arena, mark);
+	char *const second = descent_xml_arena_strndup(&arena, lit("second"));
+	assert(first == second);
+	assert(strcmp(kept, "kept") == 0);
+
+	// Filling more than a chunk moves on to new chunks, which
+	// are reused after a reset
+	char *pointers[16];
+	char value[1000];
+	memset(value, 'x', sizeof(value));
+	const lptr_t string = { value, sizeof(char), sizeof(value) };
+	for (int round = 0; round < 2; round++) {
+		descent_xml_arena_reset(&arena, mark);
+		for (int i = 0; i < 16; i++) {
+			char *const copy = descent_xml_arena_strndup(&arena, string);
+			assert(copy && strlen(copy) == sizeof(value));
+			if (round)
+				assert(copy == pointers[i]);
+			pointers[i] = copy;
+		}
+	}
+	assert(strcmp(kept, "kept") == 0);
+
+	descent_xml_arena_free(&arena);
+}
+
+void test_large(void)
+{
+	enum { SIZE = DESCENT_XML_ARENA_CHUNK * 3 };
+	struct descent_xml_arena arena = descent_xml_arena_init();
+	const struct descent_xml_arena_mark mark = descent_xml_arena_mark(&arena);
+	char *const small = descent_xml_arena_strndup(&arena, lit("small"));
+
+	char *const large = descent_xml_arena_alloc(&arena, SIZE);
+	assert(large);
+	memset(large, 'x', SIZE);
+	assert(strcmp(small, "small") == 0);
+
+	// The large chunk goes after the small one, so the small
+	// one is still used first
+	descent_xml_arena_reset(&arena, mark);
+	assert(descent_xml_arena_strndup(&arena, lit("again")) == small);
+	assert(descent_xml_arena_alloc(&arena, SIZE) == large);
+
+	descent_xml_arena_free(&arena);
+}
+
+int main()
+{
+	test_alloc();
+	test_reset();
+	test_large();
+}
@@ -511,6 +511,71 @@ void test_descent_xml_classifier_text_space(void)
 	));
 }
 
+void test_descent_xml_classifier_name_ranges(void)
+{
+	assert(expect(
+		descent_xml_classifier_element_name,
+		descent_xml_classifier_element,
+		0xE9
+	));
+	assert(expect(
+		descent_xml_classifier_element_name,
+		descent_xml_classifier_element,
+		0x10000
+	));
+	assert(expect(
+		descent_xml_classifier_unexpected,
+		descent_xml_classifier_element,
+		0x300
+	));
+	assert(expect(
+		descent_xml_classifier_element_name,
+		descent_xml_classifier_element_name,
+		0x300
+	));
+	assert(expect(
+		descent_xml_classifier_element_name,
+		descent_xml_classifier_element_name,
+		0xB7
+	));
+	assert(expect(
+		descent_xml_classifier_unexpected,
+		descent_xml_classifier_element_name,
+		0xD7
+	));
+	assert(expect(
+		descent_xml_classifier_unexpected,
+		descent_xml_classifier_element_name,
+		0x37E
+	));
+}
+
+void test_descent_xml_classifier_next(void)
+{
+	static const wint_t extra[] = {
+		0x300, 0x37E, 0x200C, 0xD800, 0xFEFF, 0x10000, 0xF0000, WEOF,
+	};
+
+	for (
+		enum descent_xml_classifier_state state = DESCENT_XML_CLASSIFIER_START;
+		state < DESCENT_XML_CLASSIFIER_STATE_COUNT;
+		state++
+	) {
+		cfn *const fn = descent_xml_classifier_state_fn(state);
+		assert(descent_xml_classifier_fn_state(fn) == state);
+
+		for (wint_t c = 0; c < 0x180; c++)
+			assert(descent_xml_classifier_state_fn(
+				descent_xml_classifier_next(state, (wchar_t)c)
+			) == (cfn*)fn((wchar_t)c));
+
+		for (size_t i = 0; i < sizeof(extra) / sizeof(*extra); i++)
+			assert(descent_xml_classifier_state_fn(
+				descent_xml_classifier_next(state, (wchar_t)extra[i])
+			) == (cfn*)fn((wchar_t)extra[i]));
+	}
+}
+
 int main()
 {
 	test_descent_xml_classifier_start();
@@ -535,4 +600,6 @@ int main()
 	test_descent_xml_classifier_text_entity_start();
 	test_descent_xml_classifier_text_entity();
 	test_descent_xml_classifier_text_space();
+	test_descent_xml_classifier_name_ranges();
+	test_descent_xml_classifier_next();
 }
@@ -0,0 +1,168 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <assert.h>
+#include <string.h>
+#include "descent-xml/dispatch.h"
+
+#include <libadt/str.h>
+
+// Generated from descent_xml_dispatch.txt
+#include "vocabulary.h"
+
+typedef struct libadt_const_lptr lptr_t;
+typedef struct descent_xml_lex lex_t;
+
+#define lit libadt_str_literal
+#define lex descent_xml_lex_init
+#define eof descent_xml_classifier_eof
+#define unexpected descent_xml_classifier_unexpected
+
+void test_find(void)
+{
+	assert(VOCABULARY_COUNT == vocabulary_table.count);
+	for (size_t id = 0; id < vocabulary_table.count; id++) {
+		const lptr_t name = vocabulary_table.names[id];
+		assert(descent_xml_dispatch_find(&vocabulary_table, name)
+			== (ssize_t)id);
+	}
+
+	assert(descent_xml_dispatch_find(&vocabulary_table, lit("book"))
+		== VOCABULARY_BOOK);
+	assert(descent_xml_dispatch_find(&vocabulary_table, lit("dc:title"))
+		== VOCABULARY_DC_TITLE);
+	assert(descent_xml_dispatch_find(&vocabulary_table, lit("h6"))
+		== VOCABULARY_H6);
+
+	assert(descent_xml_dispatch_find(&vocabulary_table, lit("")) == -1);
+	assert(descent_xml_dispatch_find(&vocabulary_table, lit("boo")) == -1);
+	assert(descent_xml_dispatch_find(&vocabulary_table, lit("books")) == -1);
+	assert(descent_xml_dispatch_find(&vocabulary_table, lit("Book")) == -1);
+	assert(descent_xml_dispatch_find(&vocabulary_table, lit("dc_title")) == -1);
+	assert(descent_xml_dispatch_find(&vocabulary_table, lit("h7")) == -1);
+}
+
+typedef struct {
+	int books;
+	int authors;
+	int others;
+	int attributes;
+} counts_t;
+
+lex_t count_book(
+	lex_t token,
+	lptr_t name,
+	lptr_t attributes,
+	bool empty,
+	void *context
+)
+{
+	(void)name;
+	(void)empty;
+	counts_t *const counts = context;
+	counts->books++;
+	counts->attributes += (int)attributes.length / 2;
+	return token;
+}
+
+lex_t count_author(
+	lex_t token,
+	lptr_t name,
+	lptr_t attributes,
+	bool empty,
+	void *context
+)
+{
+	(void)name;
+	(void)attributes;
+	assert(empty);
+	counts_t *const counts = context;
+	counts->authors++;
+	return token;
+}
+
+lex_t count_other(
+	lex_t token,
+	lptr_t name,
+	lptr_t attributes,
+	bool empty,
+	void *context
+)
+{
+	(void)name;
+	(void)attributes;
+	(void)empty;
+	counts_t *const counts = context;
+	counts->others++;
+	return token;
+}
+
+lex_t parse_all(const char *xml, struct descent_xml_dispatch *dispatch)
+{
+	lex_t token = lex((lptr_t) { xml, sizeof(char), (ssize_t)strlen(xml) });
+	do {
+		token = descent_xml_parse(
+			token,
+			descent_xml_dispatch_element,
+			NULL,
+			dispatch
+		);
+	} while (token.type != eof && token.type != unexpected);
+	return token;
+}
+
+void test_dispatch(void)
+{
+	const char *const xml =
+		"<library><book type='fiction' year='1982'><author/>"
+		"<title>Magician</title><dc:title/></book><book/><shelf/>"
+		"</library>";
+
+	descent_xml_parse_element_fn *handlers[VOCABULARY_COUNT] = {
+		[VOCABULARY_BOOK] = count_book,
+		[VOCABULARY_AUTHOR] = count_author,
+	};
+	counts_t counts = { 0 };
+	struct descent_xml_dispatch dispatch = {
+		.table = &vocabulary_table,
+		.handlers = handlers,
+		.context = &counts,
+	};
+
+	// Elements without a handler are skipped
+	assert(parse_all(xml, &dispatch).type == eof);
+	assert(counts.books == 2);
+	assert(counts.authors == 1);
+	assert(counts.attributes == 2);
+	assert(counts.others == 0);
+
+	// library, title, dc:title and the unknown shelf
+	counts = (counts_t) { 0 };
+	dispatch.fallback = count_other;
+	assert(parse_all(xml, &dispatch).type == eof);
+	assert(counts.books == 2);
+	assert(counts.authors == 1);
+	assert(counts.others == 4);
+}
+
+int main()
+{
+	test_find();
+	test_dispatch();
+}
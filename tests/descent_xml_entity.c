@@ -0,0 +1,104 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <assert.h>
+#include <string.h>
+#include "descent-xml/entity.h"
+
+#include <libadt/str.h>
+
+typedef struct libadt_const_lptr lptr_t;
+
+#define lit libadt_str_literal
+
+static bool decodes_to(lptr_t string, const char *expected)
+{
+	char buffer[64];
+	assert((size_t)string.length <= sizeof(buffer));
+	const lptr_t decoded = descent_xml_entity_decode(string, buffer);
+	return decoded.length == (ssize_t)strlen(expected)
+		&& memcmp(decoded.buffer, expected, strlen(expected)) == 0;
+}
+
+void test_untouched(void)
+{
+	char buffer[16] = { 0 };
+	const lptr_t plain = lit("no references here");
+	const lptr_t decoded = descent_xml_entity_decode(plain, buffer);
+	assert(decoded.buffer == plain.buffer);
+	assert(decoded.length == plain.length);
+	assert(buffer[0] == '\0');
+
+	const lptr_t empty = lit("");
+	assert(descent_xml_entity_decode(empty, buffer).length == 0);
+}
+
+void test_predefined(void)
+{
+	assert(decodes_to(lit("this &amp; that"), "this & that"));
+	assert(decodes_to(lit("&lt;a&gt;"), "<a>"));
+	assert(decodes_to(lit("&quot;&apos;"), "\"'"));
+	assert(decodes_to(lit("&amp;amp;"), "&amp;"));
+}
+
+void test_numeric(void)
+{
+	assert(decodes_to(lit("&#65;&#x42;&#X43;"), "AB&#X43;"));
+	assert(decodes_to(lit("&#xe9;"), "\xc3\xa9"));
+	assert(decodes_to(lit("&#x20AC;"), "\xe2\x82\xac"));
+	assert(decodes_to(lit("&#128512;"), "\xf0\x9f\x98\x80"));
+	assert(decodes_to(lit("&#x0000041;"), "A"));
+	assert(decodes_to(lit("&#10;"), "\n"));
+}
+
+void test_left_alone(void)
+{
+	// Entities without a DTD, characters XML doesn't allow and
+	// broken references are copied as they are
+	assert(decodes_to(lit("&nbsp;"), "&nbsp;"));
+	assert(decodes_to(lit("&#0;&#xD800;&#x110000;"), "&#0;&#xD800;&#x110000;"));
+	assert(decodes_to(lit("&#;&#x;&#12a;"), "&#;&#x;&#12a;"));
+	assert(decodes_to(lit("a & b"), "a & b"));
+	assert(decodes_to(lit("trailing &amp"), "trailing &amp"));
+	assert(decodes_to(lit("&"), "&"));
+	assert(decodes_to(
+		lit("&#x00000000000000000000000000000041;"),
+		"&#x00000000000000000000000000000041;"
+	));
+}
+
+void test_in_place(void)
+{
+	char text[] = "&lt;p&gt;&#x20AC;5 &amp; more";
+	const lptr_t string = { text, sizeof(char), sizeof(text) - 1 };
+	const lptr_t decoded = descent_xml_entity_decode(string, text);
+	const char expected[] = "<p>\xe2\x82\xac" "5 & more";
+	assert(decoded.buffer == text);
+	assert(decoded.length == sizeof(expected) - 1);
+	assert(memcmp(text, expected, sizeof(expected) - 1) == 0);
+}
+
+int main()
+{
+	test_untouched();
+	test_predefined();
+	test_numeric();
+	test_left_alone();
+	test_in_place();
+}
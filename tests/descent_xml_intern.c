@@ -0,0 +1,90 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "descent-xml/intern.h"
+
+#include <libadt/str.h>
+
+typedef struct libadt_const_lptr lptr_t;
+
+#define lit libadt_str_literal
+
+static bool equal(lptr_t a, lptr_t b)
+{
+	return a.length == b.length
+		&& memcmp(a.buffer, b.buffer, (size_t)a.length) == 0;
+}
+
+void test_add(void)
+{
+	struct descent_xml_intern names = descent_xml_intern_init();
+	assert(descent_xml_intern_find(&names, lit("book")) == -1);
+
+	assert(descent_xml_intern_add(&names, lit("book")) == 0);
+	assert(descent_xml_intern_add(&names, lit("author")) == 1);
+	assert(descent_xml_intern_add(&names, lit("book")) == 0);
+	assert(descent_xml_intern_add(&names, lit("boo")) == 2);
+	assert(descent_xml_intern_add(&names, lit("")) == 3);
+	assert(names.count == 4);
+
+	assert(descent_xml_intern_find(&names, lit("author")) == 1);
+	assert(descent_xml_intern_find(&names, lit("")) == 3);
+	assert(descent_xml_intern_find(&names, lit("books")) == -1);
+
+	assert(equal(descent_xml_intern_name(&names, 0), lit("book")));
+	assert(equal(descent_xml_intern_name(&names, 1), lit("author")));
+	assert(equal(descent_xml_intern_name(&names, 2), lit("boo")));
+	assert(equal(descent_xml_intern_name(&names, 3), lit("")));
+
+	descent_xml_intern_free(&names);
+	assert(names.count == 0);
+	assert(descent_xml_intern_find(&names, lit("book")) == -1);
+}
+
+void test_grow(void)
+{
+	enum { COUNT = 5000 };
+	struct descent_xml_intern names = descent_xml_intern_init();
+	char buffer[32];
+
+	for (int i = 0; i < COUNT; i++) {
+		const int length = snprintf(buffer, sizeof(buffer), "name-%d", i);
+		const lptr_t name = { buffer, sizeof(char), length };
+		assert(descent_xml_intern_add(&names, name) == i);
+	}
+	assert(names.count == COUNT);
+
+	for (int i = 0; i < COUNT; i++) {
+		const int length = snprintf(buffer, sizeof(buffer), "name-%d", i);
+		const lptr_t name = { buffer, sizeof(char), length };
+		assert(descent_xml_intern_find(&names, name) == i);
+		assert(descent_xml_intern_add(&names, name) == i);
+		assert(equal(descent_xml_intern_name(&names, (size_t)i), name));
+	}
+
+	descent_xml_intern_free(&names);
+}
+
+int main()
+{
+	test_add();
+	test_grow();
+}
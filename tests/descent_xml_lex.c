@@ -18,6 +18,7 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <locale.h>
 #include "descent-xml/lex.h"
 
 #include <libadt/str.h>
@@ -157,6 +158,405 @@ void test_comment(void)
 	assert(token.type == descent_xml_classifier_element_end);
 }
 
+void test_long_cdata(void)
+{
+	struct descent_xml_lex token = descent_xml_lex_init(lit(
+		"<![CDATA[if (a[b] < c) { return a[1]; } // a longer script]]>"
+	));
+
+	struct libadt_const_lptr expected_value = lit(
+		"![CDATA[if (a[b] < c) { return a[1]; } // a longer script]]"
+	);
+	token = descent_xml_lex_next_raw(token);
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_lex_cdata);
+	assert(libadt_const_lptr_equal(expected_value, token.value));
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_element_end);
+
+	token = descent_xml_lex_init(lit("<![CDATA[never closed]>"));
+	token = descent_xml_lex_next_raw(token);
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type != descent_xml_lex_cdata);
+}
+
+void test_long_text(void)
+{
+	struct descent_xml_lex token = descent_xml_lex_init(lit(
+		"<a>\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t"
+		"A long text node, long enough to skip over in more "
+		"than one stride, with an &amp; entity in the middle"
+		"</a>"
+	));
+
+	token = descent_xml_lex_next_raw(token);
+	token = descent_xml_lex_next_raw(token);
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_element_end);
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_text_space);
+	assert(token.value.length == 19);
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_text);
+	assert(libadt_const_lptr_equal(
+		lit("A long text node, long enough to skip over in more than one stride, with an "),
+		token.value
+	));
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_text_entity_start);
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_text_entity);
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_text);
+	assert(libadt_const_lptr_equal(
+		lit("; entity in the middle"),
+		token.value
+	));
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_element);
+}
+
+void test_long_attribute_value(void)
+{
+	struct descent_xml_lex token = descent_xml_lex_init(lit(
+		"<a href=\"https://example.com/a/fairly/long/path?with=query&amp;string=1\"/>"
+	));
+
+	token = descent_xml_lex_next_raw(token);
+	token = descent_xml_lex_next_raw(token);
+	token = descent_xml_lex_next_raw(token);
+	token = descent_xml_lex_next_raw(token);
+	token = descent_xml_lex_next_raw(token);
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_attribute_value_double_quote_start);
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_attribute_value_double_quote);
+	assert(libadt_const_lptr_equal(
+		lit("https://example.com/a/fairly/long/path?with=query"),
+		token.value
+	));
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_attribute_value_double_quote_entity_start);
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_attribute_value_double_quote_entity);
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_attribute_value_double_quote);
+	assert(libadt_const_lptr_equal(lit(";string=1"), token.value));
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_attribute_value_double_quote_end);
+}
+
+void test_multibyte(void)
+{
+	// mixes the single-byte fast path with
+	// characters that still need decoding
+#ifdef DESCENT_XML_LOCALE_DECODER
+	if (!setlocale(LC_CTYPE, "C.UTF-8"))
+		return;
+#endif
+
+	struct descent_xml_lex token = descent_xml_lex_init(lit("<caf\xc3\xa9>na\xc3\xafve</caf\xc3\xa9>"));
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_element);
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_element_name);
+	assert(libadt_const_lptr_equal(lit("caf\xc3\xa9"), token.value));
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_element_end);
+
+	token = descent_xml_lex_next_raw(token);
+	assert(token.type == descent_xml_classifier_text);
+	assert(libadt_const_lptr_equal(lit("na\xc3\xafve"), token.value));
+
+#ifdef DESCENT_XML_LOCALE_DECODER
+	setlocale(LC_CTYPE, "C");
+#endif
+}
+
+void test_utf8_decode(void)
+{
+	wchar_t c = 0;
+
+	assert(_descent_xml_lex_utf8_decode(&c, lit("a")) == 1 && c == L'a');
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xc3\xa9")) == 2 && c == 0xE9);
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xe2\x82\xac")) == 3 && c == 0x20AC);
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xef\xbb\xbf")) == 3 && c == 0xFEFF);
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xf0\x9f\x98\x80")) == 4 && c == 0x1F600);
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xf4\x8f\xbf\xbf")) == 4 && c == 0x10FFFF);
+
+	// truncated
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xe2\x82")) == -2);
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xf0")) == -2);
+
+	// stray continuation, bad lead and bad continuation bytes
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\x80")) == -1);
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xf8\x88\x80\x80\x80")) == -1);
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xe2\x28\xa1")) == -1);
+
+	// overlong encodings
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xc0\xbc")) == -1);
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xe0\x80\xbc")) == -1);
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xf0\x80\x80\xbc")) == -1);
+
+	// surrogates and past the end of Unicode
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xed\xa0\x80")) == -1);
+	assert(_descent_xml_lex_utf8_decode(&c, lit("\xf4\x90\x80\x80")) == -1);
+}
+
+void test_table_engine(void)
+{
+	const struct libadt_const_lptr scripts[] = {
+		lit(SCRIPT),
+		lit("<?xml version=\"1.0\"?>\n<!DOCTYPE root>\n<root a='1' b=\"&amp;\">\n\ttext &lt; more <![CDATA[ <raw> ]]><!-- comment --><child/></root>\n"),
+		lit("<root>unterminated"),
+		lit("<root a=\"1\" b></root>"),
+	};
+
+	for (size_t i = 0; i < sizeof(scripts) / sizeof(*scripts); i++) {
+		struct descent_xml_lex
+			fn = descent_xml_lex_init(scripts[i]),
+			table = fn;
+
+		do {
+			fn = descent_xml_lex_next_raw_fn(fn);
+			table = descent_xml_lex_next_raw_table(table);
+
+			assert(fn.type == table.type);
+			assert(libadt_const_lptr_raw(fn.value) == libadt_const_lptr_raw(table.value));
+			assert(fn.value.length == table.value.length);
+		} while (
+			fn.type != descent_xml_classifier_eof
+			&& fn.type != descent_xml_classifier_unexpected
+		);
+	}
+}
+
+void test_next_batch(void)
+{
+	enum { CAPACITY = 4 };
+	descent_xml_classifier_fn *types[CAPACITY];
+	size_t offsets[CAPACITY], lengths[CAPACITY];
+	struct descent_xml_lex_batch batch = {
+		.type = types,
+		.offset = offsets,
+		.length = lengths,
+	};
+
+	struct descent_xml_lex
+		single = descent_xml_lex_init(lit("<root a='1'>text &amp; more<child/></root>")),
+		batched = single;
+
+	size_t total = 0;
+	do {
+		batched = descent_xml_lex_next_batch(batched, &batch, CAPACITY);
+		assert(batch.count > 0 && batch.count <= CAPACITY);
+
+		for (size_t i = 0; i < batch.count; i++) {
+			single = descent_xml_lex_next_raw(single);
+			const struct descent_xml_lex stored
+				= descent_xml_lex_batch_get(batched, batch, i);
+
+			assert(stored.type == single.type);
+			assert(libadt_const_lptr_raw(stored.value) == libadt_const_lptr_raw(single.value));
+			assert(stored.value.length == single.value.length);
+		}
+		total += batch.count;
+	} while (batched.type != descent_xml_classifier_eof);
+
+	assert(single.type == descent_xml_classifier_eof);
+	assert(total > CAPACITY);
+
+	batched = descent_xml_lex_next_batch(batched, &batch, 0);
+	assert(batch.count == 0);
+	assert(batched.type == descent_xml_classifier_eof);
+}
+
+void test_compact(void)
+{
+	const struct libadt_const_lptr script = lit(
+		"<?xml version=\"1.0\"?><!DOCTYPE root><root a='1'><![CDATA[x]]><!-- c --></root>"
+	);
+	struct descent_xml_lex token = descent_xml_lex_init(script);
+
+	assert(sizeof(struct descent_xml_lex_compact) <= 16);
+
+	do {
+		token = descent_xml_lex_next_raw(token);
+
+		const struct descent_xml_lex_compact compact
+			= descent_xml_lex_to_compact(token);
+		const struct descent_xml_lex expanded
+			= descent_xml_lex_from_compact(script, compact);
+
+		assert(expanded.type == token.type);
+		assert(libadt_const_lptr_raw(expanded.value) == libadt_const_lptr_raw(token.value));
+		assert(expanded.value.length == token.value.length);
+	} while (token.type != descent_xml_classifier_eof);
+
+	for (unsigned id = 0; id < DESCENT_XML_LEX_TYPE_COUNT; id++)
+		assert(descent_xml_lex_type_id(descent_xml_lex_type_fn((unsigned char)id)) == id);
+	assert(descent_xml_lex_type_fn(DESCENT_XML_LEX_TYPE_COUNT) == descent_xml_classifier_unexpected);
+	assert(descent_xml_lex_type_id(descent_xml_lex_comment) == DESCENT_XML_LEX_COMMENT);
+}
+
+void test_push(void)
+{
+#ifdef DESCENT_XML_LOCALE_DECODER
+	if (!setlocale(LC_CTYPE, "C.UTF-8"))
+		return;
+#endif
+
+	const struct libadt_const_lptr script = lit(
+		"\xef\xbb\xbf<?xml version=\"1.0\"?>\n<!DOCTYPE root>\n"
+		"<root a='1' b=\"caf\xc3\xa9 &amp; more\">\n"
+		"\tA long text node, na\xc3\xafve, with an &lt; entity\n"
+		"\t<![CDATA[ <raw> ]]><!-- a > comment -->\n"
+		"\t<child/>\n</root>\n"
+	);
+
+	enum { MAX_TOKENS = 128 };
+	struct descent_xml_lex_compact expected[MAX_TOKENS];
+	size_t count = 0;
+	struct descent_xml_lex token = descent_xml_lex_init(script);
+	do {
+		token = descent_xml_lex_next_raw(token);
+		assert(count < MAX_TOKENS);
+		expected[count++] = descent_xml_lex_to_compact(token);
+	} while (
+		token.type != descent_xml_classifier_eof
+		&& token.type != descent_xml_classifier_unexpected
+	);
+	assert(token.type == descent_xml_classifier_eof);
+
+	for (ssize_t step = 1; step <= 9; step++) {
+		struct descent_xml_lex_push push = descent_xml_lex_push_init();
+		ssize_t received = 0;
+		size_t i = 0;
+
+		while (i < count) {
+			token = descent_xml_lex_push_next(
+				&push,
+				libadt_const_lptr_truncate(script, (size_t)received),
+				received == script.length
+			);
+
+			if (token.type == descent_xml_lex_need_input) {
+				assert(received < script.length);
+				received += step;
+				if (received > script.length)
+					received = script.length;
+				continue;
+			}
+
+			const struct descent_xml_lex_compact compact
+				= descent_xml_lex_to_compact(token);
+			assert(compact.type == expected[i].type);
+			assert(compact.offset == expected[i].offset);
+			assert(compact.length == expected[i].length);
+			i++;
+		}
+	}
+
+#ifdef DESCENT_XML_LOCALE_DECODER
+	setlocale(LC_CTYPE, "C");
+#endif
+}
+
+void test_push_discard(void)
+{
+	struct descent_xml_lex_push push = descent_xml_lex_push_init();
+	struct descent_xml_lex token;
+
+	token = descent_xml_lex_push_next(&push, lit("<root>some"), false);
+	assert(token.type == descent_xml_classifier_element);
+	token = descent_xml_lex_push_next(&push, lit("<root>some"), false);
+	assert(token.type == descent_xml_classifier_element_name);
+	token = descent_xml_lex_push_next(&push, lit("<root>some"), false);
+	assert(token.type == descent_xml_classifier_element_end);
+	token = descent_xml_lex_push_next(&push, lit("<root>some"), false);
+	assert(token.type == descent_xml_lex_need_input);
+	assert(libadt_const_lptr_equal(token.value, lit("some")));
+
+	// drop "<root" from the buffer, keeping the last token
+	assert(push.offset == 5);
+	descent_xml_lex_push_discard(&push, push.offset);
+
+	token = descent_xml_lex_push_next(&push, lit(">some text</root>"), true);
+	assert(token.type == descent_xml_classifier_text);
+	assert(libadt_const_lptr_equal(token.value, lit("some text")));
+}
+
+void test_push_markup(void)
+{
+	struct descent_xml_lex_push push = descent_xml_lex_push_init();
+	struct descent_xml_lex token;
+
+	token = descent_xml_lex_push_next(&push, lit("<!-- a -"), false);
+	assert(token.type == descent_xml_classifier_element);
+	token = descent_xml_lex_push_next(&push, lit("<!-- a -"), false);
+	assert(token.type == descent_xml_lex_need_input);
+	// the search carries on from the last byte, in case it's
+	// the start of "--"
+	assert(push.markup_scanned == 6);
+
+	token = descent_xml_lex_push_next(&push, lit("<!-- a --"), false);
+	assert(token.type == descent_xml_lex_need_input);
+	assert(push.markup_scanned == 6);
+
+	token = descent_xml_lex_push_next(&push, lit("<!-- a -->"), false);
+	assert(token.type == descent_xml_lex_comment);
+	assert(push.markup_scanned == 0);
+
+	push = descent_xml_lex_push_init();
+	token = descent_xml_lex_push_next(&push, lit("<![CDATA[ab]"), false);
+	assert(token.type == descent_xml_classifier_element);
+	token = descent_xml_lex_push_next(&push, lit("<![CDATA[ab]"), false);
+	assert(token.type == descent_xml_lex_need_input);
+	assert(push.markup_scanned == 10);
+	token = descent_xml_lex_push_next(&push, lit("<![CDATA[ab]]>"), false);
+	assert(token.type == descent_xml_lex_cdata);
+	assert(libadt_const_lptr_equal(token.value, lit("![CDATA[ab]]")));
+}
+
+void test_push_complete(void)
+{
+	struct descent_xml_lex_push push = descent_xml_lex_push_init();
+	struct descent_xml_lex token;
+
+	// '>' can't be followed by more of the same token, so it
+	// doesn't wait for the next piece of the script
+	token = descent_xml_lex_push_next(&push, lit("<root>"), false);
+	assert(token.type == descent_xml_classifier_element);
+	token = descent_xml_lex_push_next(&push, lit("<root>"), false);
+	assert(token.type == descent_xml_classifier_element_name);
+	token = descent_xml_lex_push_next(&push, lit("<root>"), false);
+	assert(token.type == descent_xml_classifier_element_end);
+	assert(libadt_const_lptr_equal(token.value, lit(">")));
+	token = descent_xml_lex_push_next(&push, lit("<root>"), false);
+	assert(token.type == descent_xml_lex_need_input);
+
+	// but a name can be
+	push = descent_xml_lex_push_init();
+	token = descent_xml_lex_push_next(&push, lit("<root"), false);
+	assert(token.type == descent_xml_classifier_element);
+	token = descent_xml_lex_push_next(&push, lit("<root"), false);
+	assert(token.type == descent_xml_lex_need_input);
+}
+
 int main()
 {
 	test_descent_xml_lex();
@@ -164,4 +564,16 @@ int main()
 	test_doctype();
 	test_cdata();
 	test_comment();
+	test_long_cdata();
+	test_long_text();
+	test_long_attribute_value();
+	test_multibyte();
+	test_table_engine();
+	test_utf8_decode();
+	test_next_batch();
+	test_compact();
+	test_push();
+	test_push_discard();
+	test_push_markup();
+	test_push_complete();
 }
@@ -0,0 +1,133 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "descent-xml/parallel.h"
+#include "descent-xml/validate.h"
+
+#include <libadt/str.h>
+
+typedef struct descent_xml_lex lex_t;
+typedef struct libadt_const_lptr lptr_t;
+
+#define lex descent_xml_lex_init
+#define lit libadt_str_literal
+
+static bool step_document(lptr_t script, int depth)
+{
+	struct descent_xml_validate_state state
+		= descent_xml_validate_state_init(depth);
+	lex_t token = lex(script);
+
+	do {
+		token = descent_xml_lex_next_raw(token);
+	} while (descent_xml_validate_step(&state, token) && !state.done);
+
+	const bool valid = state.valid;
+	descent_xml_validate_state_free(&state);
+	return valid;
+}
+
+// checks every chunk size up to the length of the script,
+// so every '<' gets to start a chunk
+static void check(lptr_t script, int depth, bool expected)
+{
+	assert(step_document(script, depth) == expected);
+
+	for (size_t chunk = 1; chunk <= (size_t)script.length + 1; chunk++) {
+		assert(descent_xml_parallel_validate_depth(lex(script), depth, 1, chunk) == expected);
+		assert(descent_xml_parallel_validate_depth(lex(script), depth, 4, chunk) == expected);
+	}
+}
+
+static const char *const valid[] = {
+	"<root/>",
+	"<root></root>\n",
+	"<?xml version=\"1.0\"?>\n<!DOCTYPE root>\n<root a='1'><b>text</b><c/></root>\n",
+	"<!-- <a> in a comment </a> -->\n<root><!-- <b> --><![CDATA[ <c></d> ]]></root>",
+	"<root>\n\t<a><b><c>deep</c></b></a>\n\t<a><b/></a>\n\ttext &amp; more\n</root>",
+	"<?xml version=\"1.0\"?><!-- x --><!DOCTYPE root><!-- y --><root/>",
+};
+
+static const char *const invalid[] = {
+	"",
+	"<root>",
+	"text<root/>",
+	"<root/>text",
+	"<root/><root/>",
+	"<root/><!-- trailing -->",
+	"<root></other>",
+	"<root><a></root></a>",
+	"<root></root></root>",
+	"<!-- x --><?xml version=\"1.0\"?><root/>",
+	"<!DOCTYPE root><!DOCTYPE root><root/>",
+	"<root><!DOCTYPE root></root>",
+	"<![CDATA[ x ]]><root/>",
+	"</root>",
+	"<root><!-- <a> </root>",
+};
+
+void test_documents(void)
+{
+	for (size_t i = 0; i < sizeof(valid) / sizeof(*valid); i++) {
+		const lptr_t script = { valid[i], 1, (ssize_t)strlen(valid[i]) };
+		check(script, 1000, true);
+	}
+
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(*invalid); i++) {
+		const lptr_t script = { invalid[i], 1, (ssize_t)strlen(invalid[i]) };
+		check(script, 1000, false);
+	}
+}
+
+void test_depth(void)
+{
+	const lptr_t script = lit("<a><b><c><d/></c></b><b><c/></b></a>");
+	check(script, 4, true);
+	check(script, 3, false);
+}
+
+// Removing any single byte from a valid document has to give
+// the same answer both ways, whatever that answer is
+void test_mutations(void)
+{
+	char buffer[256];
+
+	for (size_t i = 0; i < sizeof(valid) / sizeof(*valid); i++) {
+		const size_t length = strlen(valid[i]);
+		assert(length < sizeof(buffer));
+
+		for (size_t skip = 0; skip < length; skip++) {
+			memcpy(buffer, valid[i], skip);
+			memcpy(buffer + skip, valid[i] + skip + 1, length - skip - 1);
+			const lptr_t script = { buffer, 1, (ssize_t)length - 1 };
+
+			check(script, 1000, step_document(script, 1000));
+		}
+	}
+}
+
+int main()
+{
+	test_documents();
+	test_depth();
+	test_mutations();
+}
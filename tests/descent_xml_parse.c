@@ -18,6 +18,8 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "descent-xml/parse.h"
 
@@ -25,6 +27,8 @@
 
 #include <libadt/str.h>
 
+#include "failing_malloc.h"
+
 typedef struct descent_xml_lex lex_t;
 typedef struct libadt_const_lptr lptr_t;
 
@@ -139,6 +143,21 @@ void text_callback(
 	assert(!is_cdata);
 }
 
+lex_t count_callback(
+	lex_t token,
+	lptr_t name,
+	lptr_t attributes,
+	bool empty,
+	void *context
+)
+{
+	(void)name;
+	(void)attributes;
+	(void)empty;
+	(*(int*)context)++;
+	return token;
+}
+
 void test_text_node(void)
 {
 	{
@@ -224,6 +243,16 @@ void cdata_callback(
 	*(bool*)context = true;
 }
 
+void test_missing_attribute_value(void)
+{
+	lex_t xml = lex(lit("<a><b x=></a>"));
+	int run_times = 0;
+	while (!stop_token(xml))
+		xml = descent_xml_parse(xml, count_callback, NULL, &run_times);
+	assert(run_times == 1);
+	assert(xml.type == err);
+}
+
 void test_cdata(void)
 {
 	lex_t xml = lex(lit("<![CDATA[<element-like thing=\"asdf\"/>]]>"));
@@ -313,6 +342,667 @@ void test_cstr_text_entities(void)
 	assert(xml.type != err);
 }
 
+typedef struct {
+	char *names[8];
+	size_t count;
+} cstr_names_t;
+
+lex_t cstr_nested_callback(
+	lex_t token,
+	char *name,
+	char **attributes,
+	bool empty,
+	void *context
+)
+{
+	(void)attributes;
+	cstr_names_t *const names = context;
+	names->names[names->count++] = name;
+	if (empty)
+		return token;
+
+	// Children's copies mustn't overwrite this element's
+	char saved[16];
+	snprintf(saved, sizeof(saved), "%s", name);
+	do {
+		token = descent_xml_parse_cstr(token, cstr_nested_callback, NULL, context);
+	} while (!stop_token(token)
+		&& token.type != descent_xml_classifier_element_close_name);
+	assert(strcmp(name, saved) == 0);
+	return descent_xml_parse(token, NULL, NULL, NULL);
+}
+
+void test_cstr_nested(void)
+{
+	lex_t xml = lex(lit("<outer><first/><second><third/></second></outer>"));
+	cstr_names_t names = { 0 };
+	while (!stop_token(xml))
+		xml = descent_xml_parse_cstr(xml, cstr_nested_callback, NULL, &names);
+	assert(xml.type != err);
+	assert(names.count == 4);
+
+	// Siblings' copies reuse the same memory
+	assert(names.names[1] == names.names[2]);
+	descent_xml_parse_cstr_release();
+
+	// The memory comes back after being released
+	names.count = 0;
+	xml = lex(lit("<outer><first/></outer>"));
+	while (!stop_token(xml))
+		xml = descent_xml_parse_cstr(xml, cstr_nested_callback, NULL, &names);
+	assert(xml.type != err);
+	assert(names.count == 2);
+	descent_xml_parse_cstr_release();
+}
+
+typedef struct {
+	struct descent_xml_parse_context *parse;
+	cstr_names_t names;
+} cstr_with_t;
+
+lex_t cstr_with_callback(
+	lex_t token,
+	char *name,
+	char **attributes,
+	bool empty,
+	void *context
+)
+{
+	(void)attributes;
+	cstr_with_t *const with = context;
+	with->names.names[with->names.count++] = name;
+	if (empty)
+		return token;
+
+	do {
+		token = descent_xml_parse_cstr_with(
+			with->parse,
+			token,
+			cstr_with_callback,
+			NULL,
+			context
+		);
+	} while (!stop_token(token)
+		&& token.type != descent_xml_classifier_element_close_name);
+	return descent_xml_parse(token, NULL, NULL, NULL);
+}
+
+void test_cstr_with(void)
+{
+	struct descent_xml_parse_context parse = descent_xml_parse_context_init();
+	cstr_with_t with = { .parse = &parse };
+	descent_xml_parse_cstr_release();
+
+	lex_t xml = lex(lit("<outer><first/><second><third/></second></outer>"));
+	while (!stop_token(xml))
+		xml = descent_xml_parse_cstr_with(&parse, xml, cstr_with_callback, NULL, &with);
+	assert(xml.type != err);
+	assert(with.names.count == 4);
+	assert(with.names.names[1] == with.names.names[2]);
+
+	// The copies came from the caller's context, not the thread's
+	assert(parse._arena._first);
+	assert(!_descent_xml_parse_cstr_buffers._arena._first);
+	descent_xml_parse_context_free(&parse);
+
+	char script[] = "<a b='c'>text</a>";
+	parse = descent_xml_parse_context_init();
+	with = (cstr_with_t) { .parse = &parse };
+	xml = lex((lptr_t) { script, sizeof(char), sizeof(script) - 1 });
+	while (!stop_token(xml))
+		xml = descent_xml_parse_insitu_with(&parse, xml, cstr_with_callback, NULL, &with);
+	assert(xml.type != err);
+	assert(with.names.count == 1);
+	assert(parse._arena._first);
+	assert(!_descent_xml_parse_cstr_buffers._arena._first);
+	descent_xml_parse_context_free(&parse);
+}
+
+typedef struct {
+	int rows;
+	const void *spans[2];
+} rows_t;
+
+lex_t row_callback(
+	lex_t token,
+	lptr_t name,
+	lptr_t attributes,
+	bool empty,
+	void *context
+)
+{
+	assert(strncmp(name.buffer, "row", (size_t)name.length) == 0);
+	assert(empty);
+	assert(attributes.length == 40);
+
+	const lptr_t *const spans = attributes.buffer;
+	for (ssize_t i = 0; i < attributes.length; i += 2) {
+		char expected[8];
+		const int length = snprintf(expected, sizeof(expected), "a%d", (int)i / 2);
+		assert(spans[i].length == length);
+		assert(memcmp(spans[i].buffer, expected, (size_t)length) == 0);
+		assert(spans[i + 1].length == 1);
+		assert(*(const char *)spans[i + 1].buffer == 'v');
+	}
+
+	rows_t *const rows = context;
+	if (rows->rows < 2)
+		rows->spans[rows->rows] = attributes.buffer;
+	rows->rows++;
+	return token;
+}
+
+void test_many_attributes(void)
+{
+	char script[1024];
+	size_t length = 0;
+	for (int row = 0; row < 3; row++) {
+		length += (size_t)snprintf(&script[length], sizeof(script) - length, "<row");
+		for (int i = 0; i < 20; i++) {
+			length += (size_t)snprintf(
+				&script[length],
+				sizeof(script) - length,
+				" a%d='v'",
+				i
+			);
+		}
+		length += (size_t)snprintf(&script[length], sizeof(script) - length, "/>");
+	}
+	const lptr_t document = { script, sizeof(char), (ssize_t)length };
+
+	// Without a context, the spans are allocated for each element
+	rows_t rows = { 0 };
+	lex_t xml = lex(document);
+	while (!stop_token(xml))
+		xml = descent_xml_parse(xml, row_callback, NULL, &rows);
+	assert(xml.type == eof);
+	assert(rows.rows == 3);
+
+	// With one, the memory is reused for the next element
+	struct descent_xml_parse_context parse = descent_xml_parse_context_init();
+	rows = (rows_t) { 0 };
+	xml = lex(document);
+	while (!stop_token(xml))
+		xml = descent_xml_parse_with(&parse, xml, row_callback, NULL, &rows);
+	assert(xml.type == eof);
+	assert(rows.rows == 3);
+	assert(rows.spans[0] == rows.spans[1]);
+	descent_xml_parse_context_free(&parse);
+}
+
+typedef struct {
+	const char *document;
+	size_t length;
+	int elements;
+	int texts;
+} insitu_t;
+
+static bool inside(const insitu_t *insitu, const char *string)
+{
+	return string >= insitu->document
+		&& string < insitu->document + insitu->length;
+}
+
+lex_t insitu_element_callback(
+	lex_t token,
+	char *name,
+	char **attributes,
+	bool empty,
+	void *context
+)
+{
+	insitu_t *const insitu = context;
+	insitu->elements++;
+	assert(inside(insitu, name));
+	for (char **attribute = attributes; *attribute; attribute++)
+		assert(inside(insitu, *attribute));
+
+	if (strcmp(name, "book") == 0) {
+		assert(strcmp(attributes[0], "type") == 0);
+		assert(strcmp(attributes[1], "fiction") == 0);
+		assert(strcmp(attributes[2], "note") == 0);
+		assert(strcmp(attributes[3], "") == 0);
+		assert(!attributes[4]);
+		assert(!empty);
+
+		// Children's terminators don't disturb the parent's
+		do {
+			token = descent_xml_parse_insitu(
+				token,
+				insitu_element_callback,
+				NULL,
+				context
+			);
+		} while (!stop_token(token)
+			&& token.type != descent_xml_classifier_element_close_name);
+		assert(strcmp(name, "book") == 0);
+		assert(strcmp(attributes[1], "fiction") == 0);
+		return descent_xml_parse(token, NULL, NULL, NULL);
+	}
+
+	assert(strcmp(name, "library") == 0 || strcmp(name, "author") == 0);
+	return token;
+}
+
+void insitu_text_callback(char *text, bool is_cdata, void *context)
+{
+	insitu_t *const insitu = context;
+	insitu->texts++;
+	if (is_cdata) {
+		assert(inside(insitu, text));
+		assert(strcmp(text, "<raw>") == 0);
+	} else if (inside(insitu, text)) {
+		assert(strcmp(text, "this &amp; that") == 0);
+	} else {
+		// Text at the very end is copied
+		assert(strcmp(text, "\n") == 0);
+	}
+}
+
+void test_insitu(void)
+{
+	char document[] =
+		"<library><book type='fiction' note=\"\"><author/></book>"
+		"this &amp; that<![CDATA[<raw>]]></library>\n";
+	char original[sizeof(document)];
+	memcpy(original, document, sizeof(document));
+
+	insitu_t insitu = {
+		.document = document,
+		.length = sizeof(document) - 1,
+	};
+	lex_t xml = lex((lptr_t) { document, sizeof(char), sizeof(document) - 1 });
+	while (!stop_token(xml)) {
+		xml = descent_xml_parse_insitu(
+			xml,
+			insitu_element_callback,
+			insitu_text_callback,
+			&insitu
+		);
+	}
+	assert(xml.type != err);
+	assert(insitu.elements == 3);
+	assert(insitu.texts == 3);
+
+	// Every overwritten byte was put back
+	assert(memcmp(document, original, sizeof(document)) == 0);
+	descent_xml_parse_cstr_release();
+}
+
+typedef struct {
+	char log[256];
+	size_t length;
+	const char *stop_at;
+	size_t depth;
+	size_t max_depth;
+} events_t;
+
+static void log_event(events_t *events, const char *prefix, lptr_t value, const char *suffix)
+{
+	const int written = snprintf(
+		events->log + events->length,
+		sizeof(events->log) - events->length,
+		"%s%.*s%s",
+		prefix,
+		(int)value.length,
+		(const char *)value.buffer,
+		suffix
+	);
+	assert(written > 0);
+	events->length += (size_t)written;
+	assert(events->length < sizeof(events->log));
+}
+
+static bool should_stop(const events_t *events, lptr_t name)
+{
+	return events->stop_at
+		&& strncmp(name.buffer, events->stop_at, (size_t)name.length) == 0;
+}
+
+bool log_start(const struct descent_xml_parse_element *element, void *context)
+{
+	events_t *const events = context;
+	log_event(events, "<", element->name, "");
+	for (ssize_t i = 0; i < element->attributes.length; i += 2) {
+		const lptr_t *const attribute = raw(index(element->attributes, i));
+		const lptr_t *const value = raw(index(element->attributes, i + 1));
+		log_event(events, " ", *attribute, "=");
+		log_event(events, "", *value, "");
+	}
+	log_event(events, "", lit(""), element->empty ? "/>" : ">");
+	return !should_stop(events, element->name);
+}
+
+bool log_end(const struct descent_xml_parse_element *element, void *context)
+{
+	events_t *const events = context;
+	assert(element->attributes.length == 0);
+	log_event(events, "</", element->name, ">");
+	return true;
+}
+
+bool log_text(lptr_t text, bool is_cdata, void *context)
+{
+	events_t *const events = context;
+	log_event(events, is_cdata ? "{" : "[", text, is_cdata ? "}" : "]");
+	return true;
+}
+
+void test_events(void)
+{
+	const lptr_t script = lit(
+		"<?xml version=\"1.0\"?>"
+		"<a x='1' y=\"2\">t &amp; u<b/><![CDATA[<c>]]><!-- d --><c>e</c></a>"
+	);
+	const char *const expected =
+		"<a x=1 y=2>[t &amp; u]<b/></b>{<c>}<c>[e]</c></a>";
+
+	events_t events = { 0 };
+	const struct descent_xml_parse_handlers handlers = {
+		.start = log_start,
+		.end = log_end,
+		.text = log_text,
+		.context = &events,
+	};
+	lex_t xml = descent_xml_parse_events(lex(script), &handlers);
+	assert(xml.type == eof);
+	assert(strcmp(events.log, expected) == 0);
+
+	// stopping part of the way through, then carrying on
+	events = (events_t) { .stop_at = "c" };
+	xml = descent_xml_parse_events(lex(script), &handlers);
+	assert(xml.type != eof && xml.type != err);
+	assert(strcmp(events.log, "<a x=1 y=2>[t &amp; u]<b/></b>{<c>}<c>") == 0);
+	xml = descent_xml_parse_events(xml, &handlers);
+	assert(xml.type == eof);
+	assert(strcmp(events.log, expected) == 0);
+
+	// stopping at an empty element still ends it
+	events = (events_t) { .stop_at = "b" };
+	xml = descent_xml_parse_events(lex(script), &handlers);
+	assert(xml.type != eof && xml.type != err);
+	assert(strcmp(events.log, "<a x=1 y=2>[t &amp; u]<b/></b>") == 0);
+	xml = descent_xml_parse_events(xml, &handlers);
+	assert(xml.type == eof);
+	assert(strcmp(events.log, expected) == 0);
+
+	events = (events_t) { 0 };
+	xml = descent_xml_parse_events(lex(lit("<a><b x=></a>")), &handlers);
+	assert(xml.type == err);
+}
+
+bool log_segments(lptr_t segments, void *context)
+{
+	events_t *const events = context;
+	const struct descent_xml_parse_segment *const segment = segments.buffer;
+	for (ssize_t i = 0; i < segments.length; i++) {
+		switch (segment[i].type) {
+		case DESCENT_XML_PARSE_SEGMENT_TEXT:
+			log_event(events, "[", segment[i].value, "]");
+			break;
+		case DESCENT_XML_PARSE_SEGMENT_ENTITY:
+			log_event(events, "(", segment[i].value, ")");
+			break;
+		case DESCENT_XML_PARSE_SEGMENT_CDATA:
+			log_event(events, "{", segment[i].value, "}");
+			break;
+		}
+	}
+	log_event(events, "|", lit(""), "");
+	return true;
+}
+
+void test_events_segments(void)
+{
+	const lptr_t script = lit(
+		"<a>t &amp; u&#38;<![CDATA[<c>]]><![CDATA[]]> v &lt;<b/>"
+		"&gt;&gt;<!-- d -->w</a>"
+	);
+	events_t events = { 0 };
+	const struct descent_xml_parse_handlers handlers = {
+		.start = log_start,
+		.end = log_end,
+		.text = log_text,
+		.context = &events,
+		.segments = log_segments,
+	};
+	const lex_t xml = descent_xml_parse_events(lex(script), &handlers);
+	assert(xml.type == eof);
+	assert(strcmp(
+		events.log,
+		"<a>[t ](&amp;)[ u](&#38;){<c>}{}[ v ](&lt;)|<b/></b>"
+		"(&gt;)(&gt;)|[w]|</a>"
+	) == 0);
+}
+
+void test_events_attributes_error(void)
+{
+#ifdef FAILING_MALLOC
+	// More attributes than fit on the stack, so collecting them
+	// has to allocate
+	const lptr_t script = lit(
+		"<a><b a0='' a1='' a2='' a3='' a4='' a5='' a6='' a7='' a8=''/></a>"
+	);
+	events_t events = { 0 };
+	const struct descent_xml_parse_handlers handlers = {
+		.start = log_start,
+		.end = log_end,
+		.context = &events,
+	};
+
+	fail_malloc = true;
+	const lex_t xml = descent_xml_parse_events(lex(script), &handlers);
+	fail_malloc = false;
+
+	assert(xml.type == descent_xml_parse_error);
+	assert(strcmp(events.log, "<a>") == 0);
+#endif
+}
+
+enum { BOOK, AUTHOR, TYPE };
+
+typedef struct {
+	struct descent_xml_intern *names;
+	int books;
+	int authors;
+	int types;
+	int others;
+} ids_t;
+
+bool id_start(const struct descent_xml_parse_element *element, void *context)
+{
+	ids_t *const ids = context;
+	assert(element->attribute_ids || !element->attributes.length);
+	assert(
+		libadt_const_lptr_equal(
+			element->name,
+			descent_xml_intern_name(ids->names, (size_t)element->id)
+		)
+	);
+
+	switch (element->id) {
+	case BOOK:
+		ids->books++;
+		break;
+	case AUTHOR:
+		ids->authors++;
+		break;
+	default:
+		ids->others++;
+	}
+
+	for (ssize_t i = 0; i < element->attributes.length / 2; i++)
+		if (element->attribute_ids[i] == TYPE)
+			ids->types++;
+	return true;
+}
+
+bool id_end(const struct descent_xml_parse_element *element, void *context)
+{
+	ids_t *const ids = context;
+	assert(element->id >= 0);
+	assert(
+		libadt_const_lptr_equal(
+			element->name,
+			descent_xml_intern_name(ids->names, (size_t)element->id)
+		)
+	);
+	return true;
+}
+
+void test_events_names(void)
+{
+	struct descent_xml_intern names = descent_xml_intern_init();
+	assert(descent_xml_intern_add(&names, lit("book")) == BOOK);
+	assert(descent_xml_intern_add(&names, lit("author")) == AUTHOR);
+	assert(descent_xml_intern_add(&names, lit("type")) == TYPE);
+
+	ids_t ids = { .names = &names };
+	const struct descent_xml_parse_handlers handlers = {
+		.start = id_start,
+		.end = id_end,
+		.context = &ids,
+		.names = &names,
+	};
+	const lex_t xml = descent_xml_parse_events(
+		lex(lit(
+			"<library><book type='fiction' year='1982'><author/>"
+			"<title>Magician</title></book><book type='x'/></library>"
+		)),
+		&handlers
+	);
+	assert(xml.type == eof);
+	assert(ids.books == 2);
+	assert(ids.authors == 1);
+	assert(ids.types == 2);
+	assert(ids.others == 2);
+
+	// library, title and year were added after the known names
+	assert(names.count == 6);
+	assert(descent_xml_intern_find(&names, lit("year")) >= TYPE);
+
+	descent_xml_intern_free(&names);
+}
+
+bool unknown_start(const struct descent_xml_parse_element *element, void *context)
+{
+	ids_t *const ids = context;
+	if (element->id == DESCENT_XML_PARSE_UNKNOWN_NAME)
+		ids->others++;
+	else if (element->id == BOOK)
+		ids->books++;
+	for (ssize_t i = 0; i < element->attributes.length / 2; i++)
+		if (element->attribute_ids[i] == DESCENT_XML_PARSE_UNKNOWN_NAME)
+			ids->others++;
+	return true;
+}
+
+void test_events_names_limit(void)
+{
+	struct descent_xml_intern names = descent_xml_intern_init();
+	assert(descent_xml_intern_add(&names, lit("book")) == BOOK);
+	const lptr_t script = lit(
+		"<library><book type='fiction' year='1982'/><shelf/></library>"
+	);
+
+	// Only looking names up leaves the table as it was
+	ids_t ids = { .names = &names };
+	struct descent_xml_parse_handlers handlers = {
+		.start = unknown_start,
+		.context = &ids,
+		.names = &names,
+		.names_limit = names.count,
+	};
+	assert(descent_xml_parse_events(lex(script), &handlers).type == eof);
+	assert(ids.books == 1);
+	assert(ids.others == 4);
+	assert(names.count == 1);
+
+	// A limit lets the first few new names in
+	ids = (ids_t) { .names = &names };
+	handlers.names_limit = 3;
+	assert(descent_xml_parse_events(lex(script), &handlers).type == eof);
+	assert(ids.books == 1);
+	assert(ids.others == 2);
+	assert(names.count == 3);
+	assert(descent_xml_intern_find(&names, lit("library")) == 1);
+	assert(descent_xml_intern_find(&names, lit("type")) == 2);
+	assert(descent_xml_intern_find(&names, lit("shelf")) == -1);
+
+	descent_xml_intern_free(&names);
+
+	// Without a limit, the default one applies
+	enum { NAMES = DESCENT_XML_PARSE_NAMES_LIMIT + 100 };
+	char *const many = malloc(NAMES * 16 + 16);
+	assert(many);
+	size_t length = (size_t)sprintf(many, "<r>");
+	for (int i = 0; i < NAMES; i++)
+		length += (size_t)sprintf(many + length, "<e%d/>", i);
+	length += (size_t)sprintf(many + length, "</r>");
+
+	names = descent_xml_intern_init();
+	ids = (ids_t) { .names = &names };
+	handlers = (struct descent_xml_parse_handlers) {
+		.start = unknown_start,
+		.context = &ids,
+		.names = &names,
+	};
+	const lptr_t script_many = { many, sizeof(char), (ssize_t)length };
+	assert(descent_xml_parse_events(lex(script_many), &handlers).type == eof);
+	assert(names.count == DESCENT_XML_PARSE_NAMES_LIMIT);
+	assert(ids.others == NAMES + 1 - DESCENT_XML_PARSE_NAMES_LIMIT);
+
+	descent_xml_intern_free(&names);
+	free(many);
+}
+
+bool depth_start(const struct descent_xml_parse_element *element, void *context)
+{
+	(void)element;
+	events_t *const events = context;
+	if (++events->depth > events->max_depth)
+		events->max_depth = events->depth;
+	return true;
+}
+
+bool depth_end(const struct descent_xml_parse_element *element, void *context)
+{
+	(void)element;
+	events_t *const events = context;
+	events->depth--;
+	return true;
+}
+
+void test_events_deep(void)
+{
+	enum { DEPTH = 100000 };
+	char *const script = malloc(DEPTH * 7);
+	assert(script);
+
+	size_t length = 0;
+	for (size_t i = 0; i < DEPTH; i++, length += 3)
+		memcpy(&script[length], "<a>", 3);
+	for (size_t i = 0; i < DEPTH; i++, length += 4)
+		memcpy(&script[length], "</a>", 4);
+
+	events_t events = { 0 };
+	const struct descent_xml_parse_handlers handlers = {
+		.start = depth_start,
+		.end = depth_end,
+		.context = &events,
+	};
+	const lptr_t deep = {
+		.buffer = script,
+		.size = sizeof(char),
+		.length = (ssize_t)length,
+	};
+	assert(descent_xml_parse_events(lex(deep), &handlers).type == eof);
+	assert(events.max_depth == DEPTH);
+	assert(events.depth == 0);
+
+	free(script);
+}
+
 int main()
 {
 	test_empty_element_no_attributes();
@@ -320,7 +1010,18 @@ int main()
 	test_attribute_entities();
 	test_text_node();
 	test_text_entities();
+	test_missing_attribute_value();
 	test_cstr_empty_element_no_attributes();
 	test_cstr_element_attributes();
 	test_cstr_text_entities();
+	test_cstr_nested();
+	test_cstr_with();
+	test_many_attributes();
+	test_insitu();
+	test_events();
+	test_events_deep();
+	test_events_names();
+	test_events_names_limit();
+	test_events_segments();
+	test_events_attributes_error();
 }
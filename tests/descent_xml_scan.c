@@ -0,0 +1,138 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include "descent-xml/scan.h"
+
+#include <libadt/str.h>
+
+#define lit libadt_str_literal
+
+// Long enough to go through the 32- and 16-byte
+// strides as well as the byte-by-byte tail
+#define LONG_TEXT \
+	"Lorem ipsum dolor sit amet, consectetur adipiscing elit, " \
+	"sed do eiusmod tempor incididunt ut labore et dolore magna"
+
+void test_scan_text(void)
+{
+	assert(descent_xml_scan_text(lit("")) == 0);
+	assert(descent_xml_scan_text(lit("<")) == 0);
+	assert(descent_xml_scan_text(lit("abc")) == 3);
+	assert(descent_xml_scan_text(lit("a b\tc")) == 5);
+	assert(descent_xml_scan_text(lit("abc<def")) == 3);
+	assert(descent_xml_scan_text(lit("abc&amp;")) == 3);
+	assert(descent_xml_scan_text(lit("abc%ref;")) == 3);
+	assert(descent_xml_scan_text(lit("na\xc3\xafve")) == 2);
+
+	assert(descent_xml_scan_text(lit(LONG_TEXT)) == sizeof(LONG_TEXT) - 1);
+	assert(descent_xml_scan_text(lit(LONG_TEXT "<")) == sizeof(LONG_TEXT) - 1);
+	assert(descent_xml_scan_text(lit(LONG_TEXT "&" LONG_TEXT)) == sizeof(LONG_TEXT) - 1);
+
+	// check every position, so each kernel finds
+	// a stop byte in each lane
+	char buffer[sizeof(LONG_TEXT)];
+	for (size_t i = 0; i < sizeof(buffer) - 1; i++) {
+		memcpy(buffer, LONG_TEXT, sizeof(buffer));
+		buffer[i] = '<';
+		struct libadt_const_lptr string = lit(buffer);
+		assert(descent_xml_scan_text(string) == (ssize_t)i);
+
+		buffer[i] = '\0';
+		assert(descent_xml_scan_text(string) == (ssize_t)i);
+
+		buffer[i] = (char)0xC3;
+		assert(descent_xml_scan_text(string) == (ssize_t)i);
+	}
+}
+
+void test_scan_attribute_value(void)
+{
+	assert(descent_xml_scan_attribute_value(lit("abc\""), '"') == 3);
+	assert(descent_xml_scan_attribute_value(lit("it's\""), '"') == 4);
+	assert(descent_xml_scan_attribute_value(lit("it's\""), '\'') == 2);
+	assert(descent_xml_scan_attribute_value(lit("a<b"), '"') == 1);
+	assert(descent_xml_scan_attribute_value(lit("a&amp;"), '"') == 1);
+	assert(descent_xml_scan_attribute_value(lit("a%ref;"), '\'') == 1);
+	assert(descent_xml_scan_attribute_value(lit("abc"), '"') == 3);
+	assert(descent_xml_scan_attribute_value(lit(LONG_TEXT "\""), '"') == sizeof(LONG_TEXT) - 1);
+
+	char buffer[sizeof(LONG_TEXT)];
+	for (size_t i = 0; i < sizeof(buffer) - 1; i++) {
+		memcpy(buffer, LONG_TEXT, sizeof(buffer));
+		buffer[i] = '"';
+		struct libadt_const_lptr string = lit(buffer);
+		assert(descent_xml_scan_attribute_value(string, '"') == (ssize_t)i);
+		assert(descent_xml_scan_attribute_value(string, '\'') == sizeof(buffer) - 1);
+	}
+}
+
+void test_scan_space(void)
+{
+	assert(descent_xml_scan_space(lit("")) == 0);
+	assert(descent_xml_scan_space(lit("a")) == 0);
+	assert(descent_xml_scan_space(lit(" \t\r\na")) == 4);
+	assert(descent_xml_scan_space(lit("  ")) == 2);
+
+	char buffer[100];
+	memset(buffer, ' ', sizeof(buffer));
+	struct libadt_const_lptr string = {
+		.buffer = buffer,
+		.size = sizeof(char),
+		.length = sizeof(buffer),
+	};
+	assert(descent_xml_scan_space(string) == sizeof(buffer));
+
+	for (size_t i = 0; i < sizeof(buffer); i++) {
+		buffer[i] = '<';
+		assert(descent_xml_scan_space(string) == (ssize_t)i);
+		buffer[i] = '\n';
+	}
+}
+
+void test_scan_pair(void)
+{
+	assert(descent_xml_scan_pair(lit(""), ']', ']') == -1);
+	assert(descent_xml_scan_pair(lit("]"), ']', ']') == -1);
+	assert(descent_xml_scan_pair(lit("]]"), ']', ']') == 0);
+	assert(descent_xml_scan_pair(lit("a]b]]"), ']', ']') == 3);
+	assert(descent_xml_scan_pair(lit("a-b-c"), '-', '-') == -1);
+	assert(descent_xml_scan_pair(lit(LONG_TEXT), '-', '-') == -1);
+	assert(descent_xml_scan_pair(lit(LONG_TEXT "--"), '-', '-') == sizeof(LONG_TEXT) - 1);
+
+	// includes pairs straddling the end of each block
+	char buffer[sizeof(LONG_TEXT)];
+	for (size_t i = 0; i < sizeof(buffer) - 2; i++) {
+		memcpy(buffer, LONG_TEXT, sizeof(buffer));
+		buffer[i] = ']';
+		struct libadt_const_lptr string = lit(buffer);
+		assert(descent_xml_scan_pair(string, ']', ']') == -1);
+
+		buffer[i + 1] = ']';
+		assert(descent_xml_scan_pair(string, ']', ']') == (ssize_t)i);
+	}
+}
+
+int main()
+{
+	test_scan_text();
+	test_scan_attribute_value();
+	test_scan_space();
+	test_scan_pair();
+}
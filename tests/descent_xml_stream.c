@@ -0,0 +1,113 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "descent-xml/stream.h"
+
+#include <libadt/str.h>
+
+#define lit libadt_str_literal
+
+#define SCRIPT \
+	"<?xml version=\"1.0\"?>\n" \
+	"<!-- a comment, longer than the window -->\n" \
+	"<root a='1' b=\"some &amp; value\">\n" \
+	"\tA text node that's longer than the window, with an &lt; entity\n" \
+	"\t<![CDATA[ <raw> ]]>\n" \
+	"\t<child/>\n" \
+	"</root>\n"
+
+static FILE *file_with(struct libadt_const_lptr script)
+{
+	FILE *const file = tmpfile();
+	assert(file);
+	assert(fwrite(script.buffer, 1, (size_t)script.length, file) == (size_t)script.length);
+	assert(fflush(file) == 0);
+	rewind(file);
+	return file;
+}
+
+void test_stream_next(void)
+{
+	const struct libadt_const_lptr script = lit(SCRIPT);
+
+	for (size_t window = 1; window <= 64; window *= 2) {
+		FILE *const file = file_with(script);
+		struct descent_xml_stream stream;
+		assert(descent_xml_stream_init(&stream, fileno(file), window) == 0);
+
+		struct descent_xml_lex expected = descent_xml_lex_init(script);
+		do {
+			expected = descent_xml_lex_next_raw(expected);
+			const struct descent_xml_lex token
+				= descent_xml_stream_next(&stream);
+
+			assert(token.type == expected.type);
+			assert(libadt_const_lptr_equal(token.value, expected.value));
+		} while (expected.type != descent_xml_classifier_eof);
+
+		assert(stream.eof);
+		assert(!stream.error);
+		descent_xml_stream_free(&stream);
+		fclose(file);
+	}
+}
+
+void test_stream_validate(void)
+{
+	{
+		FILE *const file = file_with(lit(SCRIPT));
+		struct descent_xml_stream stream;
+		assert(descent_xml_stream_init(&stream, fileno(file), 16) == 0);
+		assert(descent_xml_stream_validate(&stream));
+		descent_xml_stream_free(&stream);
+		fclose(file);
+	}
+
+	{
+		FILE *const file = file_with(lit("<root><child></root></child>"));
+		struct descent_xml_stream stream;
+		assert(descent_xml_stream_init(&stream, fileno(file), 16) == 0);
+		assert(!descent_xml_stream_validate(&stream));
+		descent_xml_stream_free(&stream);
+		fclose(file);
+	}
+}
+
+void test_stream_error(void)
+{
+	struct descent_xml_stream stream;
+	assert(descent_xml_stream_init(&stream, -1, 0) == 0);
+
+	const struct descent_xml_lex token = descent_xml_stream_next(&stream);
+	assert(token.type == descent_xml_classifier_unexpected);
+	assert(stream.error);
+	assert(!descent_xml_stream_validate(&stream));
+	descent_xml_stream_free(&stream);
+}
+
+int main()
+{
+	test_stream_next();
+	test_stream_validate();
+	test_stream_error();
+}
@@ -18,15 +18,20 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include "descent-xml/validate.h"
 
 #include <libadt/str.h>
 
+#include "failing_malloc.h"
+
 typedef struct descent_xml_lex lex_t;
 typedef struct libadt_const_lptr lptr_t;
 
 #define lex descent_xml_lex_init
 #define lit libadt_str_literal
+#define COUNT(array) (sizeof(array) / sizeof(*(array)))
 
 void test_valid(void)
 {
@@ -142,10 +147,419 @@ void test_invalid(void)
 
 		assert(!descent_xml_validate_document(invalid));
 	}
+
+	{
+		lex_t invalid = lex(lit("<? ml version=\"1.0\"?>\n<root/>"));
+		assert(!descent_xml_validate_document(invalid));
+		assert(!descent_xml_validate_element(invalid));
+	}
+
+	// The recursive validator accepted these: it didn't need
+	// a root element, and only checked what came after one
+	// for text and a second element
+	{
+		static const char *const documents[] = {
+			"</b>",
+			"<!-- c -->text",
+			"<![CDATA[z]]>",
+			"<!DOCTYPE a><!DOCTYPE a>",
+			"<?xml version=\"1.0\"?></b>",
+		};
+		for (size_t i = 0; i < COUNT(documents); i++) {
+			const lex_t invalid = lex((lptr_t) {
+				.buffer = documents[i],
+				.size = sizeof(char),
+				.length = (ssize_t)strlen(documents[i]),
+			});
+			assert(!descent_xml_validate_document(invalid));
+		}
+	}
+}
+
+void test_deep(void)
+{
+	// far deeper than the C stack would allow
+	enum { DEPTH = 200000 };
+	char *const script = malloc(DEPTH * 7 + 1);
+	assert(script);
+
+	size_t length = 0;
+	for (size_t i = 0; i < DEPTH; i++, length += 3)
+		memcpy(&script[length], "<a>", 3);
+	for (size_t i = 0; i < DEPTH; i++, length += 4)
+		memcpy(&script[length], "</a>", 4);
+
+	const lptr_t deep = {
+		.buffer = script,
+		.size = sizeof(char),
+		.length = (ssize_t)length,
+	};
+	assert(descent_xml_validate_document_depth(lex(deep), -1));
+	assert(descent_xml_validate_document_depth(lex(deep), DEPTH));
+	assert(!descent_xml_validate_document_depth(lex(deep), DEPTH - 1));
+	assert(!descent_xml_validate_document(lex(deep)));
+	assert(descent_xml_validate_element_depth(lex(deep), -1));
+	assert(!descent_xml_validate_element(lex(deep)));
+
+	// one closing tag short
+	const lptr_t unclosed = libadt_const_lptr_truncate(deep, length - 4);
+	assert(!descent_xml_validate_document_depth(lex(unclosed), -1));
+	assert(!descent_xml_validate_element_depth(lex(unclosed), -1));
+
+	free(script);
+}
+
+static const lptr_t valid_documents[] = {
+	lit("<foo><foo></foo><bar></bar></foo>"),
+	lit("<foo />"),
+	lit("<?xml version=\"1.0\"?>\n<foo></foo>"),
+	lit("<!DOCTYPE html>\n<html></html>"),
+	lit(
+		"<?xml version=\"1.0\"?>\n"
+		"<!-- This is a comment -->\n"
+		"<!DOCTYPE html>\n"
+		"<!-- A third, for good measure -->\n"
+		"<html a='1'>text &amp; <![CDATA[<x>]]><!-- c --><b/></html>\n"
+	),
+	lit("<!-- A Valid Comment -->\n<root></root>"),
+};
+static const lptr_t invalid_documents[] = {
+	lit("<foo></bar>"),
+	lit("<foo><bar></bar>"),
+	lit("<foo><bar></bar></bar>"),
+	lit("<root></root>foo"),
+	lit("<?xml version=\"1.0\"?>"),
+	lit(""),
+	lit("<foo></foo><bar></bar>"),
+	lit("<?xml version=\"1.0\" ?>foo<root></root>"),
+	lit("<?xml version=\"1.0\" ?><root></root>foo"),
+	lit("<?xml version=\"1.0\" ?><root></root>&gt;"),
+	lit("<!DOCTYPE html>text<html></html>"),
+	lit("<root><!DOCTYPE html></root>"),
+	lit("<root>"),
+};
+
+static bool step_document(lptr_t script, int depth)
+{
+	struct descent_xml_validate_state state
+		= descent_xml_validate_state_init(depth);
+	lex_t token = lex(script);
+
+	do {
+		token = descent_xml_lex_next_raw(token);
+	} while (descent_xml_validate_step(&state, token) && !state.done);
+
+	const bool valid = state.valid;
+	descent_xml_validate_state_free(&state);
+	return valid;
+}
+
+void test_step(void)
+{
+	for (size_t i = 0; i < COUNT(valid_documents); i++) {
+		assert(descent_xml_validate_document(lex(valid_documents[i])));
+		assert(step_document(valid_documents[i], 1000));
+	}
+
+	for (size_t i = 0; i < COUNT(invalid_documents); i++) {
+		assert(!descent_xml_validate_document(lex(invalid_documents[i])));
+		assert(!step_document(invalid_documents[i], 1000));
+	}
+
+	const lptr_t nested = lit("<a><b><c></c></b></a>");
+	assert(descent_xml_validate_document_depth(lex(nested), 3));
+	assert(step_document(nested, 3));
+	assert(!descent_xml_validate_document_depth(lex(nested), 2));
+	assert(!step_document(nested, 2));
+
+	// empty elements don't count towards the depth
+	// once they're done
+	const lptr_t siblings = lit("<a><b/><b/><b/><b/></a>");
+	assert(descent_xml_validate_document_depth(lex(siblings), 2));
+	assert(step_document(siblings, 2));
+}
+
+typedef struct {
+	struct descent_xml_validate_state *state;
+	size_t elements;
+	size_t texts;
+} counts_t;
+
+static void count_text(lptr_t text, bool is_cdata, void *context)
+{
+	(void)text;
+	(void)is_cdata;
+	counts_t *const counts = context;
+	counts->texts++;
+}
+
+static lex_t count_element(
+	lex_t token,
+	lptr_t element_name,
+	lptr_t attributes,
+	bool empty,
+	void *context
+)
+{
+	(void)element_name;
+	(void)attributes;
+	(void)empty;
+	counts_t *const counts = context;
+	counts->elements++;
+	return token;
+}
+
+static bool finished(lex_t token)
+{
+	return token.type == descent_xml_classifier_eof
+		|| token.type == descent_xml_classifier_unexpected
+		|| token.type == descent_xml_validate_error;
+}
+
+// Reads its children with plain descent_xml_parse(), so the
+// validator has to catch up when it returns
+static lex_t skip_element(
+	lex_t token,
+	lptr_t element_name,
+	lptr_t attributes,
+	bool empty,
+	void *context
+)
+{
+	count_element(token, element_name, attributes, empty, context);
+	if (empty)
+		return token;
+
+	while (token.type != descent_xml_classifier_element_close_name) {
+		if (finished(token))
+			return token;
+		token = descent_xml_parse(token, NULL, NULL, NULL);
+	}
+	return descent_xml_parse(token, NULL, NULL, NULL);
+}
+
+// Reads its children with the same validator
+static lex_t nested_element(
+	lex_t token,
+	lptr_t element_name,
+	lptr_t attributes,
+	bool empty,
+	void *context
+)
+{
+	count_element(token, element_name, attributes, empty, context);
+	if (empty)
+		return token;
+
+	counts_t *const counts = context;
+	while (token.type != descent_xml_classifier_element_close_name) {
+		if (finished(token))
+			return token;
+		token = descent_xml_validate_parse(
+			counts->state,
+			token,
+			nested_element,
+			count_text,
+			counts
+		);
+	}
+	return descent_xml_validate_parse(counts->state, token, NULL, NULL, NULL);
+}
+
+static bool parse_document(
+	lptr_t script,
+	descent_xml_parse_element_fn *element_handler,
+	counts_t *counts
+)
+{
+	struct descent_xml_validate_state state
+		= descent_xml_validate_state_init(1000);
+	*counts = (counts_t) { .state = &state };
+	lex_t token = lex(script);
+
+	while (!finished(token))
+		token = descent_xml_validate_parse(
+			&state,
+			token,
+			element_handler,
+			count_text,
+			counts
+		);
+
+	const bool valid = token.type == descent_xml_classifier_eof;
+	assert(valid == state.valid);
+	descent_xml_validate_state_free(&state);
+	return valid;
+}
+
+void test_parse(void)
+{
+	counts_t flat, skipped, nested;
+
+	for (size_t i = 0; i < COUNT(valid_documents); i++) {
+		assert(parse_document(valid_documents[i], count_element, &flat));
+		assert(parse_document(valid_documents[i], skip_element, &skipped));
+		assert(parse_document(valid_documents[i], nested_element, &nested));
+
+		assert(flat.elements > 0);
+		assert(flat.elements == nested.elements);
+		assert(flat.texts == nested.texts);
+	}
+
+	for (size_t i = 0; i < COUNT(invalid_documents); i++) {
+		assert(!parse_document(invalid_documents[i], count_element, &flat));
+		assert(!parse_document(invalid_documents[i], skip_element, &skipped));
+		assert(!parse_document(invalid_documents[i], nested_element, &nested));
+	}
+
+	// callbacks run as the document is read, up until the error
+	assert(!parse_document(lit("<a>one<b>two</c></a>"), count_element, &flat));
+	assert(flat.elements == 2);
+	assert(flat.texts == 2);
+}
+
+static void count_text_cstr(char *text, bool is_cdata, void *context)
+{
+	(void)text;
+	(void)is_cdata;
+	counts_t *const counts = context;
+	counts->texts++;
+}
+
+static lex_t count_element_cstr(
+	lex_t token,
+	char *element_name,
+	char **attributes,
+	bool empty,
+	void *context
+)
+{
+	(void)element_name;
+	(void)attributes;
+	(void)empty;
+	counts_t *const counts = context;
+	counts->elements++;
+	return token;
+}
+
+void test_parse_cstr(void)
+{
+	struct descent_xml_validate_state state
+		= descent_xml_validate_state_init(1000);
+	counts_t counts = { .state = &state };
+	lex_t token = lex(lit("<a>one<b>two</b>three</a>"));
+
+	while (!finished(token))
+		token = descent_xml_validate_parse_cstr(
+			&state,
+			token,
+			count_element_cstr,
+			count_text_cstr,
+			&counts
+		);
+	assert(token.type == descent_xml_classifier_eof);
+	assert(state.valid);
+	assert(counts.elements == 2);
+	assert(counts.texts == 3);
+	descent_xml_validate_state_free(&state);
+
+#ifdef FAILING_MALLOC
+	// Copying the text fails, which has to stop the parse
+	// rather than skip the text
+	state = descent_xml_validate_state_init(1000);
+	counts = (counts_t) { .state = &state };
+	token = lex(lit("<a>one</a>"));
+
+	while (token.type != descent_xml_classifier_element_end)
+		token = descent_xml_validate_parse_cstr(
+			&state,
+			token,
+			count_element_cstr,
+			count_text_cstr,
+			&counts
+		);
+	assert(counts.elements == 1);
+
+	// an empty context has to allocate for the copy
+	struct descent_xml_parse_context parse = descent_xml_parse_context_init();
+	fail_malloc = true;
+	token = descent_xml_validate_parse_cstr_with(
+		&parse,
+		&state,
+		token,
+		count_element_cstr,
+		count_text_cstr,
+		&counts
+	);
+	fail_malloc = false;
+	assert(token.type == descent_xml_parse_error);
+	assert(counts.texts == 0);
+	descent_xml_parse_context_free(&parse);
+	descent_xml_validate_state_free(&state);
+#endif
+}
+
+void test_parse_with(void)
+{
+	// More attributes than fit on the stack, so they're kept
+	// in the context
+	const lptr_t script = lit(
+		"<a><b a0='' a1='' a2='' a3='' a4='' a5='' a6='' a7='' a8=''/>t</a>"
+	);
+	struct descent_xml_parse_context parse = descent_xml_parse_context_init();
+	struct descent_xml_validate_state state
+		= descent_xml_validate_state_init(1000);
+	counts_t counts = { .state = &state };
+	lex_t token = lex(script);
+
+	while (!finished(token))
+		token = descent_xml_validate_parse_with(
+			&parse,
+			&state,
+			token,
+			count_element,
+			count_text,
+			&counts
+		);
+	assert(token.type == descent_xml_classifier_eof);
+	assert(counts.elements == 2);
+	assert(counts.texts == 1);
+	assert(parse._arena._first);
+	descent_xml_validate_state_free(&state);
+	descent_xml_parse_context_free(&parse);
+
+	// The copies come from the caller's context, not the thread's
+	descent_xml_parse_cstr_release();
+	parse = descent_xml_parse_context_init();
+	state = descent_xml_validate_state_init(1000);
+	counts = (counts_t) { .state = &state };
+	token = lex(script);
+
+	while (!finished(token))
+		token = descent_xml_validate_parse_cstr_with(
+			&parse,
+			&state,
+			token,
+			count_element_cstr,
+			count_text_cstr,
+			&counts
+		);
+	assert(token.type == descent_xml_classifier_eof);
+	assert(counts.elements == 2);
+	assert(counts.texts == 1);
+	assert(parse._arena._first);
+	assert(!_descent_xml_parse_cstr_buffers._arena._first);
+	descent_xml_validate_state_free(&state);
+	descent_xml_parse_context_free(&parse);
 }
 
 int main()
 {
 	test_valid();
 	test_invalid();
+	test_step();
+	test_deep();
+	test_parse();
+	test_parse_cstr();
+	test_parse_with();
 }
@@ -0,0 +1,55 @@
+/*
+ * XMLTree - An XML Parser-Helper Library
+ * Copyright (C) 2025  Marcus Harrison
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DESCENT_XML_TEST_FAILING_MALLOC
+#define DESCENT_XML_TEST_FAILING_MALLOC
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Lets tests make allocations fail, by replacing malloc(), calloc()
+// and realloc() for the whole process: while fail_malloc is set,
+// they all return NULL. Sanitizers replace them themselves, so
+// they're left alone under them, and FAILING_MALLOC isn't defined.
+//
+// Include this from one test file per executable.
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define FAILING_MALLOC
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+
+static bool fail_malloc = false;
+
+void *malloc(size_t size)
+{
+	return fail_malloc ? NULL : __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+	return fail_malloc ? NULL : __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+	return fail_malloc ? NULL : __libc_realloc(pointer, size);
+}
+#endif
+
+#endif // DESCENT_XML_TEST_FAILING_MALLOC